@@ -0,0 +1,238 @@
+#include "AssetStreamer.h"
+#include "BufferUtils.h"
+#include "Instance.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "UploadBatch.h"
+#include "VolumeFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+AssetStreamer::AssetStreamer(Device* device)
+  : device(device), queue(QueueFlags::Transfer) {
+    // The transfer queue is in the graphics family (see Instance), and streamed images are shared with
+    // the compute family, so they are sampled without ownership transfers
+    const QueueFamilyIndices& indices = device->GetInstance()->GetQueueFamilyIndices();
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = indices[queue];
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(device->GetVkDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool");
+    }
+}
+
+AssetStreamer::~AssetStreamer() {
+    // Jobs still decoding write into their staging buffers, let them finish before freeing anything
+    for (Request* request : decoding) {
+        try {
+            request->decoded.get();
+        } catch (const std::exception&) {
+        }
+        BufferUtils::DestroyBuffer(device, request->stagingBuffer, request->stagingMemory);
+        delete request;
+    }
+
+    // Deleting a batch waits for its fence, the textures never made it into a slot
+    for (PendingUpload& upload : uploading) {
+        delete upload.batch;
+        for (Request* request : upload.requests) {
+            DestroyTexture(request->texture);
+            delete request;
+        }
+    }
+
+    vkDestroyCommandPool(device->GetVkDevice(), commandPool, nullptr);
+}
+
+void AssetStreamer::RequestTexture3D(const std::string& path, glm::ivec3 dimension, Texture** slot, UploadBatch* batch) {
+    BindPlaceholder(slot, batch);
+    StreamTexture3D(path, dimension, slot);
+}
+
+void AssetStreamer::BindPlaceholder(Texture** slot, UploadBatch* batch) {
+    UploadBatch localBatch(device, commandPool, queue);
+    *slot = Image::CreatePlaceholderTexture3D(device, commandPool, batch ? batch : &localBatch);
+    localBatch.Submit();
+}
+
+void AssetStreamer::StreamTexture3D(const std::string& path, glm::ivec3 dimension, Texture** slot) {
+    Request* request = new Request();
+    request->path = path;
+    request->dimension = dimension;
+    request->slot = slot;
+    request->start = std::chrono::high_resolution_clock::now();
+    failed.erase(std::remove(failed.begin(), failed.end(), slot), failed.end());
+    request->decoded = ThreadPool::Get().Enqueue([this, request]() { Decode(request); });
+    decoding.push_back(request);
+}
+
+bool AssetStreamer::Update() {
+    // Everything decoded since the last frame goes out in one fenced submission
+    UploadBatch* batch = nullptr;
+    std::vector<Request*> submitted;
+    for (auto it = decoding.begin(); it != decoding.end();) {
+        Request* request = *it;
+        if (request->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+        it = decoding.erase(it);
+
+        // A missing or broken volume keeps its placeholder, the rest of the scene still renders
+        try {
+            request->decoded.get();
+        } catch (const std::exception& e) {
+            std::cout << "Failed to stream " << request->path << ": " << e.what() << std::endl;
+            failed.push_back(request->slot);
+            BufferUtils::DestroyBuffer(device, request->stagingBuffer, request->stagingMemory);
+            delete request;
+            continue;
+        }
+
+        if (!batch) {
+            batch = new UploadBatch(device, commandPool, queue);
+        }
+        RecordUpload(*batch, request);
+        submitted.push_back(request);
+    }
+
+    if (batch) {
+        batch->SubmitAsync();
+        uploading.push_back({ batch, submitted });
+    }
+
+    bool swapped = false;
+    auto waitForRenderQueues = [&]() {
+        // The replaced textures are bound in descriptor sets used by frames still in flight
+        if (!swapped) {
+            vkQueueWaitIdle(device->GetQueue(QueueFlags::Compute));
+            vkQueueWaitIdle(device->GetQueue(QueueFlags::Graphics));
+            swapped = true;
+        }
+    };
+
+    for (Texture** slot : evicting) {
+        waitForRenderQueues();
+        DestroyTexture(*slot);
+        BindPlaceholder(slot);
+    }
+    evicting.clear();
+
+    for (auto it = uploading.begin(); it != uploading.end();) {
+        if (!it->batch->IsComplete()) {
+            ++it;
+            continue;
+        }
+
+        waitForRenderQueues();
+        for (Request* request : it->requests) {
+            DestroyTexture(*request->slot);
+            *request->slot = request->texture;
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - request->start;
+            std::cout << "Streamed in " << request->path << " after " << elapsed.count() << " ms" << std::endl;
+            delete request;
+        }
+
+        delete it->batch;
+        it = uploading.erase(it);
+    }
+
+    return swapped;
+}
+
+bool AssetStreamer::HasFailed(Texture** slot) const {
+    return std::find(failed.begin(), failed.end(), slot) != failed.end();
+}
+
+void AssetStreamer::Evict(Texture** slot) {
+    if (std::find(evicting.begin(), evicting.end(), slot) == evicting.end()) {
+        evicting.push_back(slot);
+    }
+}
+
+bool AssetStreamer::IsStreaming(Texture** slot) const {
+    for (const Request* request : decoding) {
+        if (request->slot == slot) {
+            return true;
+        }
+    }
+    for (const PendingUpload& upload : uploading) {
+        for (const Request* request : upload.requests) {
+            if (request->slot == slot) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Runs on a ThreadPool worker, only touches the request, the allocator and the files
+void AssetStreamer::Decode(Request* request) {
+    TRACE_ZONE("AssetStreamer::Decode", request->path);
+
+    VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    glm::ivec3 dimension = request->dimension;
+
+    VolumeFile volume;
+    std::string packedPath = VolumeFile::GetPackedPath(request->path);
+    if (volume.Open(packedPath)) {
+        // The packed volume carries its own extent and bounds, the requested dimension only describes the slices
+        const VolumeHeader& header = volume.GetHeader();
+        glm::ivec3 packedDimension(header.width, header.height, header.depth);
+        if (packedDimension != dimension) {
+            std::cout << "Using " << packedPath << " at " << header.width << "x" << header.height << "x" << header.depth << std::endl;
+        }
+        request->dimension = packedDimension;
+        request->format = volume.GetFormat();
+        request->boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        request->boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        BufferUtils::CreateBuffer(device, header.dataSize, stagingUsage, stagingProperties, request->stagingBuffer, request->stagingMemory);
+        memcpy(request->stagingMemory.mappedData, volume.GetData(), static_cast<size_t>(header.dataSize));
+        return;
+    }
+
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(dimension.x) * dimension.y * dimension.z * 4;
+    request->format = VK_FORMAT_R8G8B8A8_UNORM;
+    BufferUtils::CreateBuffer(device, imageSize, stagingUsage, stagingProperties, request->stagingBuffer, request->stagingMemory);
+    Image::DecodeSlices(request->path.c_str(), dimension, static_cast<unsigned char*>(request->stagingMemory.mappedData));
+}
+
+void AssetStreamer::RecordUpload(UploadBatch& batch, Request* request) {
+    // The batch frees the staging buffer once its fence has signaled
+    batch.AddStagingBuffer(request->stagingBuffer, request->stagingMemory);
+
+    Texture* texture = new Texture();
+    Image::Create3D(device,
+        request->dimension,
+        request->format,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        texture->image,
+        texture->imageMemory);
+
+    batch.TransitionLayout(texture->image, request->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    batch.CopyBufferToImage(request->stagingBuffer, texture->image, request->dimension.x, request->dimension.y, request->dimension.z);
+    batch.TransitionLayout(texture->image, request->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    texture->imageView = Image::CreateView(device, texture->image, request->format, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
+    texture->sampler = Image::CreateSampler(device);
+    texture->dimension = request->dimension;
+    texture->boundsMin = request->boundsMin;
+    texture->boundsMax = request->boundsMax;
+    request->texture = texture;
+}
+
+void AssetStreamer::DestroyTexture(Texture* texture) {
+    vkDestroySampler(device->GetVkDevice(), texture->sampler, nullptr);
+    texture->CleanUp(device);
+    delete texture;
+}
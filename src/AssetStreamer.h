@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include "Device.h"
+#include "Image.h"
+
+class UploadBatch;
+
+// Streams 3D textures in after startup so the first frame does not wait on decoding.
+// A request binds an empty placeholder to its slot right away, the volume is decoded on the
+// ThreadPool into a staging buffer, uploaded with a fenced batch on the transfer queue and
+// swapped into the slot by Update() once the GPU is done with the copy.
+class AssetStreamer {
+public:
+    explicit AssetStreamer(Device* device);
+    ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    // *slot gets a placeholder immediately (recorded into batch if given) and is replaced by the
+    // packed volume or .tga slices at path later on. The caller owns whatever texture is in *slot.
+    // dimension is the extent of the slices, a packed volume brings its own (see Texture::dimension).
+    void RequestTexture3D(const std::string& path, glm::ivec3 dimension, Texture** slot, UploadBatch* batch = nullptr);
+
+    void BindPlaceholder(Texture** slot, UploadBatch* batch = nullptr);
+    // Keeps the texture currently in *slot bound until the streamed one replaces it
+    void StreamTexture3D(const std::string& path, glm::ivec3 dimension, Texture** slot);
+    // Puts a placeholder back into *slot on the next Update() and frees the texture it held
+    void Evict(Texture** slot);
+
+    // Call once per frame from the render thread, before anything is submitted.
+    // Returns true when slots changed, descriptor sets and recorded commands using them must be rewritten.
+    bool Update();
+
+    bool IsStreaming(Texture** slot) const;
+    // The last stream into slot could not be decoded, *slot still holds what it had before. Cleared by the next stream.
+    bool HasFailed(Texture** slot) const;
+    uint32_t GetPendingCount() const { return static_cast<uint32_t>(decoding.size() + uploading.size()); }
+    bool IsIdle() const { return GetPendingCount() == 0; }
+
+private:
+    struct Request {
+        std::string path;
+        glm::ivec3 dimension;
+        Texture** slot;
+        std::chrono::high_resolution_clock::time_point start;
+
+        // Filled by the decode job, a packed volume replaces dimension with its own
+        std::future<void> decoded;
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        Allocation stagingMemory;
+
+        Texture* texture = nullptr;
+    };
+
+    struct PendingUpload {
+        UploadBatch* batch;
+        std::vector<Request*> requests;
+    };
+
+    void Decode(Request* request);
+    void RecordUpload(UploadBatch& batch, Request* request);
+    void DestroyTexture(Texture* texture);
+
+    Device* device;
+    QueueFlags queue;
+    VkCommandPool commandPool;
+
+    std::vector<Request*> decoding;
+    std::vector<PendingUpload> uploading;
+    std::vector<Texture**> evicting;
+    std::vector<Texture**> failed;
+};
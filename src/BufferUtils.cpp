@@ -1,34 +1,32 @@
 #include "BufferUtils.h"
 #include "Instance.h"
+#include "Trace.h"
 
-void BufferUtils::CreateBuffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+#include <cstring>
+
+void BufferUtils::CreateBuffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory) {
     // Create buffer
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    // Uniform and storage buffers are read by the graphics and compute queues alike
+    const std::vector<uint32_t>& queueFamilies = device->GetSharedQueueFamilies();
+    bufferInfo.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+    bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+    bufferInfo.pQueueFamilyIndices = queueFamilies.data();
 
     if (vkCreateBuffer(device->GetVkDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create vertex buffer");
     }
 
-    // Query buffer's memory requirements
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device->GetVkDevice(), buffer, &memRequirements);
-
-    // Allocate memory in device
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = device->GetInstance()->GetMemoryTypeIndex(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device->GetVkDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to allocate vertex buffer");
-    }
+    // Sub-allocate from the device's memory pools and bind
+    bufferMemory = device->GetAllocator()->AllocateForBuffer(buffer, properties);
+}
 
-    // Associate allocated memory with vertex buffer
-    vkBindBufferMemory(device->GetVkDevice(), buffer, bufferMemory, 0);
+void BufferUtils::DestroyBuffer(Device* device, VkBuffer buffer, Allocation& bufferMemory) {
+    vkDestroyBuffer(device->GetVkDevice(), buffer, nullptr);
+    device->GetAllocator()->Free(bufferMemory);
 }
 
 void BufferUtils::CopyBuffer(Device* device, VkCommandPool commandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -63,20 +61,17 @@ void BufferUtils::CopyBuffer(Device* device, VkCommandPool commandPool, VkBuffer
     vkFreeCommandBuffers(device->GetVkDevice(), commandPool, 1, &commandBuffer);
 }
 
-void BufferUtils::CreateBufferFromData(Device* device, VkCommandPool commandPool, void* bufferData, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void BufferUtils::CreateBufferFromData(Device* device, VkCommandPool commandPool, void* bufferData, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkBuffer& buffer, Allocation& bufferMemory) {
     // Create the staging buffer
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    Allocation stagingBufferMemory;
 
     VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     BufferUtils::CreateBuffer(device, bufferSize, stagingUsage, stagingProperties, stagingBuffer, stagingBufferMemory);
 
-    // Fill the staging buffer
-    void *data;
-    vkMapMemory(device->GetVkDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, bufferData, static_cast<size_t>(bufferSize));
-    vkUnmapMemory(device->GetVkDevice(), stagingBufferMemory);
+    // Fill the staging buffer, host visible allocations are persistently mapped
+    memcpy(stagingBufferMemory.mappedData, bufferData, static_cast<size_t>(bufferSize));
 
     // Create the buffer
     VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | bufferUsage;
@@ -85,19 +80,18 @@ void BufferUtils::CreateBufferFromData(Device* device, VkCommandPool commandPool
 
     // Copy data from staging to buffer
     BufferUtils::CopyBuffer(device, commandPool, stagingBuffer, buffer, bufferSize);
+    Trace::AddBytesUploaded(bufferSize);
 
     // No need for the staging buffer anymore
-    vkDestroyBuffer(device->GetVkDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device->GetVkDevice(), stagingBufferMemory, nullptr);
+    BufferUtils::DestroyBuffer(device, stagingBuffer, stagingBufferMemory);
 }
 
 void UniformBuffer::MapMemory(Device* device, VkDeviceSize size) {
     BufferUtils::CreateBuffer(device, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, bufferMemory);
-    vkMapMemory(device->GetVkDevice(), bufferMemory, 0, size, 0, &mappedData);
+    mappedData = bufferMemory.mappedData;
 }
 
 void UniformBuffer::Clean(Device* device) {
-    vkUnmapMemory(device->GetVkDevice(), bufferMemory);
-    vkDestroyBuffer(device->GetVkDevice(), buffer, nullptr);
-    vkFreeMemory(device->GetVkDevice(), bufferMemory, nullptr);
+    BufferUtils::DestroyBuffer(device, buffer, bufferMemory);
+    mappedData = nullptr;
 }
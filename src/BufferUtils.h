@@ -5,7 +5,7 @@
 
 struct UniformBuffer {
     VkBuffer buffer;
-    VkDeviceMemory bufferMemory;
+    Allocation bufferMemory;
     void* mappedData;
 
     void MapMemory(Device* device, VkDeviceSize size);
@@ -13,7 +13,8 @@ struct UniformBuffer {
 };
 
 namespace BufferUtils {
-    void CreateBuffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    void CreateBuffer(Device* device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory);
+    void DestroyBuffer(Device* device, VkBuffer buffer, Allocation& bufferMemory);
     void CopyBuffer(Device* device, VkCommandPool commandPool, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-    void CreateBufferFromData(Device* device, VkCommandPool commandPool, void* bufferData, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    void CreateBufferFromData(Device* device, VkCommandPool commandPool, void* bufferData, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkBuffer& buffer, Allocation& bufferMemory);
 }
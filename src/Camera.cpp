@@ -8,7 +8,7 @@
 
 #include "Camera.h"
 
-Camera::Camera(Device* device, float aspectRatio) : device(device) {
+Camera::Camera(Device* device, float aspectRatio, uint32_t frameCount) : device(device) {
     r = 10.0f;
     theta = 0.0f;
     phi = 0.0f;
@@ -29,35 +29,43 @@ Camera::Camera(Device* device, float aspectRatio) : device(device) {
 
     // phi, theta
 
-    camBuffer.MapMemory(device, sizeof(CameraBufferObject));
-    memcpy(camBuffer.mappedData, &cameraBufferObject, sizeof(CameraBufferObject));
-
-    // Create a second buffer for the previous frame
+    // The previous frame starts out as the current one
     prevCameraBufferObject.CopyFrom(cameraBufferObject);
-    prevCamBuffer.MapMemory(device, sizeof(CameraBufferObject));
-    memcpy(prevCamBuffer.mappedData, &prevCameraBufferObject, sizeof(CameraBufferObject));
 
-    // Create a buffer for camera parameters
     cameraParamBufferObject.aspectRatio = aspectRatio;
     cameraParamBufferObject.halfTanFOV = tan(glm::radians(45.0f / 2.0f));
     cameraParamBufferObject.pixelOffset = 0;
 
-    cameraParamBuffer.MapMemory(device, sizeof(CameraParamBufferObject));
-    memcpy(cameraParamBuffer.mappedData, &cameraParamBufferObject, sizeof(CameraParamBufferObject));
-
     UpdateOrbit(0.f, 0.f, 0.f);
+
+    // Camera, previous camera and parameter buffers for every frame in flight
+    camBuffers.resize(frameCount);
+    prevCamBuffers.resize(frameCount);
+    cameraParamBuffers.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; ++i) {
+        camBuffers[i].MapMemory(device, sizeof(CameraBufferObject));
+        prevCamBuffers[i].MapMemory(device, sizeof(CameraBufferObject));
+        cameraParamBuffers[i].MapMemory(device, sizeof(CameraParamBufferObject));
+        UpdateBuffers(i);
+    }
 }
 
-VkBuffer Camera::GetPrevBuffer() const {
-    return prevCamBuffer.buffer;
+VkBuffer Camera::GetPrevBuffer(uint32_t frame) const {
+    return prevCamBuffers[frame].buffer;
 }
 
-VkBuffer Camera::GetBuffer() const {
-    return camBuffer.buffer;
+VkBuffer Camera::GetBuffer(uint32_t frame) const {
+    return camBuffers[frame].buffer;
 }
 
-VkBuffer Camera::GetCameraParamBuffer() const {
-	return cameraParamBuffer.buffer;
+VkBuffer Camera::GetCameraParamBuffer(uint32_t frame) const {
+	return cameraParamBuffers[frame].buffer;
+}
+
+void Camera::UpdateBuffers(uint32_t frame) {
+    memcpy(camBuffers[frame].mappedData, &cameraBufferObject, sizeof(CameraBufferObject));
+    memcpy(prevCamBuffers[frame].mappedData, &prevCameraBufferObject, sizeof(CameraBufferObject));
+    memcpy(cameraParamBuffers[frame].mappedData, &cameraParamBufferObject, sizeof(CameraParamBufferObject));
 }
 
 void Camera::UpdateOrbit(float deltaX, float deltaY, float deltaZ) {
@@ -74,8 +82,6 @@ void Camera::UpdateOrbit(float deltaX, float deltaY, float deltaZ) {
     lookAtDir = -glm::vec3(cameraBufferObject.viewMatrix[0][2], cameraBufferObject.viewMatrix[1][2], cameraBufferObject.viewMatrix[2][2]);
     right = glm::vec3(cameraBufferObject.viewMatrix[0][0], cameraBufferObject.viewMatrix[1][0], cameraBufferObject.viewMatrix[2][0]);
     up = glm::vec3(cameraBufferObject.viewMatrix[0][1], cameraBufferObject.viewMatrix[1][1], cameraBufferObject.viewMatrix[2][1]);
-
-    memcpy(camBuffer.mappedData, &cameraBufferObject, sizeof(CameraBufferObject));
 }
 
 void Camera::UpdatePosition(Direction dir)
@@ -112,7 +118,6 @@ void Camera::UpdatePosition(Direction dir)
     target += stepSize * vecDir;
     offset += stepSize * vecDir;
     radius = glm::abs(450.f - stepSize * vecDir.y);
-    memcpy(camBuffer.mappedData, &cameraBufferObject, sizeof(CameraBufferObject));
 }
 
 void Camera::RotateCam(Direction dir)
@@ -138,18 +143,14 @@ void Camera::RotateCam(Direction dir)
     lookAtDir = -glm::vec3(cameraBufferObject.viewMatrix[0][2], cameraBufferObject.viewMatrix[1][2], cameraBufferObject.viewMatrix[2][2]);
     right = glm::vec3(cameraBufferObject.viewMatrix[0][0], cameraBufferObject.viewMatrix[1][0], cameraBufferObject.viewMatrix[2][0]);
     up = glm::vec3(cameraBufferObject.viewMatrix[0][1], cameraBufferObject.viewMatrix[1][1], cameraBufferObject.viewMatrix[2][1]);
-
-    memcpy(camBuffer.mappedData, &cameraBufferObject, sizeof(CameraBufferObject));
 }
 
 void Camera::UpdatePrevBuffer() {
     prevCameraBufferObject.CopyFrom(cameraBufferObject);
-    memcpy(prevCamBuffer.mappedData, &prevCameraBufferObject, sizeof(CameraBufferObject));
 }
 
 void Camera::UpdatePixelOffset() {
     cameraParamBufferObject.pixelOffset = (cameraParamBufferObject.pixelOffset + 1) % 16;
-	memcpy(cameraParamBuffer.mappedData, &cameraParamBufferObject, sizeof(CameraParamBufferObject));
 }
 
 float& Camera::getStepSize()
@@ -163,7 +164,9 @@ void Camera::setStepSize(float step)
 }
 
 Camera::~Camera() {
-    camBuffer.Clean(device);
-    prevCamBuffer.Clean(device);
-    cameraParamBuffer.Clean(device);
+    for (size_t i = 0; i < camBuffers.size(); ++i) {
+        camBuffers[i].Clean(device);
+        prevCamBuffers[i].Clean(device);
+        cameraParamBuffers[i].Clean(device);
+    }
 }
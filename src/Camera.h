@@ -2,6 +2,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <vector>
 #include "Device.h"
 #include "BufferUtils.h"
 
@@ -37,14 +38,15 @@ class Camera {
 private:
     Device* device;
     
+    // The mutators only change these, UpdateBuffers copies them into the buffers of a frame in flight
     CameraBufferObject cameraBufferObject;
-    UniformBuffer camBuffer;
-
-    CameraBufferObject prevCameraBufferObject; // TODO: update this in the update loop
-    UniformBuffer prevCamBuffer;
-
+    CameraBufferObject prevCameraBufferObject;
     CameraParamBufferObject cameraParamBufferObject;
-    UniformBuffer cameraParamBuffer;
+
+    // One of each per frame in flight
+    std::vector<UniformBuffer> camBuffers;
+    std::vector<UniformBuffer> prevCamBuffers;
+    std::vector<UniformBuffer> cameraParamBuffers;
 
     float r, theta, phi;
     float radius;
@@ -58,12 +60,15 @@ private:
     float stepSize = 5.0f;
 
 public:
-    Camera(Device* device, float aspectRatio);
+    Camera(Device* device, float aspectRatio, uint32_t frameCount = 1);
     ~Camera();
 
-    VkBuffer GetPrevBuffer() const;
-    VkBuffer GetBuffer() const;
-    VkBuffer GetCameraParamBuffer() const;
+    VkBuffer GetPrevBuffer(uint32_t frame) const;
+    VkBuffer GetBuffer(uint32_t frame) const;
+    VkBuffer GetCameraParamBuffer(uint32_t frame) const;
+
+    // Call once the fence of the frame's previous submission has signaled
+    void UpdateBuffers(uint32_t frame);
     
     void UpdateOrbit(float deltaX, float deltaY, float deltaZ);
     void UpdatePosition(Direction dir);
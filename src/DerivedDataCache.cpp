@@ -0,0 +1,266 @@
+#include "DerivedDataCache.h"
+#include "MappedFile.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    const char* SOURCE_INDEX = "sources.idx";
+
+    // Keys only need to tell inputs apart, not survive adversarial data. Eight bytes per step keeps hashing
+    // the ~70 MB of shipped slices well below the cost of decoding them, which byte-wise FNV-1a is not.
+    uint64_t HashBytes(const uint8_t* data, size_t size, uint64_t hash) {
+        const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * multiplier;
+            hash ^= hash >> 32;
+        }
+        for (; i < size; ++i) {
+            hash = (hash ^ data[i]) * multiplier;
+        }
+        return hash ^ (hash >> 29);
+    }
+
+    uint64_t HashString(const std::string& value, uint64_t hash) {
+        return HashBytes(reinterpret_cast<const uint8_t*>(value.data()), value.size(), hash);
+    }
+
+    std::string ToHex(uint64_t value) {
+        char buffer[17];
+        snprintf(buffer, sizeof(buffer), "%016" PRIx64, value);
+        return buffer;
+    }
+}
+
+DerivedDataCache::DerivedDataCache(const std::string& directory, uint64_t maxBytes)
+  : directory(directory), maxBytes(maxBytes) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "Failed to create derived data cache " << directory << ": " << error.message() << std::endl;
+    }
+    LoadSourceHashes();
+}
+
+DerivedDataCache::~DerivedDataCache() {
+    SaveSourceHashes();
+}
+
+std::string DerivedDataCache::MakeKey(const std::vector<std::string>& sourcePaths, const std::string& parameters) {
+    uint64_t key = HashString(parameters, VERSION);
+    for (const std::string& path : sourcePaths) {
+        uint64_t sourceHash;
+        if (!HashSource(path, sourceHash)) {
+            return std::string();
+        }
+        key = HashBytes(reinterpret_cast<const uint8_t*>(&sourceHash), sizeof(sourceHash), key);
+    }
+    return ToHex(key);
+}
+
+bool DerivedDataCache::Find(const std::string& key, VolumeFile& volume) {
+    std::string path = GetEntryPath(key);
+
+    bool found = false;
+    try {
+        found = volume.Open(path);
+    } catch (const std::exception& e) {
+        // Only complete files are ever renamed into place, but the directory is user writable
+        std::cout << e.what() << ", dropping the cache entry" << std::endl;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+
+    if (found) {
+        // The write time doubles as the last use time for Trim()
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (found) {
+        ++stats.hits;
+        stats.bytesRead += volume.GetHeader().dataSize;
+    } else {
+        ++stats.misses;
+    }
+    return found;
+}
+
+void DerivedDataCache::Store(const std::string& key, const VolumeHeader& header, const void* data) {
+    TRACE_ZONE("DerivedDataCache::Store", key);
+    try {
+        VolumeFile::Write(GetEntryPath(key), header, data);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats.stores;
+    stats.bytesWritten += static_cast<uint64_t>(header.width) * header.height * header.depth * header.texelSize;
+    Trim();
+}
+
+DerivedDataStats DerivedDataCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void DerivedDataCache::PrintStats() const {
+    DerivedDataStats current = GetStats();
+    std::cout << "Derived data cache: " << current.hits << " hits (" << (current.bytesRead >> 20) << " MB), "
+              << current.misses << " misses, " << current.stores << " stores (" << (current.bytesWritten >> 20) << " MB), "
+              << current.evictions << " evictions" << std::endl;
+}
+
+DerivedDataCache& DerivedDataCache::Get() {
+    static DerivedDataCache cache((std::filesystem::path(PROJECT_DIRECTORY) / "cache").string());
+    return cache;
+}
+
+std::string DerivedDataCache::GetEntryPath(const std::string& key) const {
+    return (std::filesystem::path(directory) / (key + ".pvol")).string();
+}
+
+bool DerivedDataCache::HashSource(const std::string& path, uint64_t& hash) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    int64_t writeTime = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    if (error) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sourceHashes.find(path);
+        if (it != sourceHashes.end() && it->second.size == size && it->second.writeTime == writeTime) {
+            hash = it->second.hash;
+            return true;
+        }
+    }
+
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    hash = HashBytes(file.GetData(), file.GetSize(), 0xcbf29ce484222325ull);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sourceHashes[path] = { size, writeTime, hash };
+    sourceHashesChanged = true;
+    return true;
+}
+
+void DerivedDataCache::LoadSourceHashes() {
+    std::ifstream in(std::filesystem::path(directory) / SOURCE_INDEX);
+    std::string line;
+    while (std::getline(in, line)) {
+        // "<hash> <size> <write time> <path>", the path may contain spaces so it goes last
+        std::istringstream fields(line);
+        std::string hash;
+        SourceHash entry;
+        if (!(fields >> hash >> entry.size >> entry.writeTime)) {
+            continue;
+        }
+        std::string path;
+        std::getline(fields >> std::ws, path);
+        if (path.empty()) {
+            continue;
+        }
+        // A torn or hand edited line is dropped, the source is just hashed again
+        char* end = nullptr;
+        errno = 0;
+        entry.hash = strtoull(hash.c_str(), &end, 16);
+        if (hash.empty() || *end != '\0' || errno == ERANGE) {
+            continue;
+        }
+        sourceHashes[path] = entry;
+    }
+}
+
+void DerivedDataCache::SaveSourceHashes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!sourceHashesChanged) {
+        return;
+    }
+
+    std::filesystem::path path = std::filesystem::path(directory) / SOURCE_INDEX;
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        for (const auto& source : sourceHashes) {
+            out << ToHex(source.second.hash) << " " << source.second.size << " " << source.second.writeTime << " " << source.first << "\n";
+        }
+        if (!out) {
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error) {
+        std::filesystem::remove(tmpPath, error);
+        return;
+    }
+    sourceHashesChanged = false;
+}
+
+void DerivedDataCache::Trim() {
+    struct Entry {
+        std::filesystem::file_time_type lastUse;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t totalBytes = 0;
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+        if (file.path().extension() != ".pvol") {
+            continue;
+        }
+        Entry entry;
+        entry.lastUse = file.last_write_time(error);
+        entry.size = file.file_size(error);
+        if (error) {
+            continue;
+        }
+        entry.path = file.path();
+        totalBytes += entry.size;
+        entries.push_back(std::move(entry));
+    }
+
+    if (totalBytes <= maxBytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+    for (const Entry& entry : entries) {
+        if (totalBytes <= maxBytes) {
+            break;
+        }
+        // Fails for entries that are still mapped on Windows, they stay until the next store
+        if (std::filesystem::remove(entry.path, error)) {
+            totalBytes -= entry.size;
+            ++stats.evictions;
+        }
+    }
+}
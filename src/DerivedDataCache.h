@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "VolumeFile.h"
+
+struct DerivedDataStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t stores = 0;
+    uint32_t evictions = 0;
+    uint64_t bytesRead = 0;     // texel bytes served from the cache
+    uint64_t bytesWritten = 0;
+};
+
+// On-disk cache of converted texel data (decoded .tga stacks, rasterized .vdb grids) stored as .pvol files.
+// Entries are keyed by the content of every source file plus the conversion parameters, so an edited
+// source or a changed conversion never serves stale data. The least recently used entries are deleted
+// once the directory grows past maxBytes. Safe to use from the decode workers.
+class DerivedDataCache {
+public:
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 2ull << 30;
+    // Part of every key, bump it when a conversion changes its output
+    static constexpr uint32_t VERSION = 1;
+
+    DerivedDataCache(const std::string& directory, uint64_t maxBytes = DEFAULT_MAX_BYTES);
+    ~DerivedDataCache();
+
+    DerivedDataCache(const DerivedDataCache&) = delete;
+    DerivedDataCache& operator=(const DerivedDataCache&) = delete;
+
+    // Empty if a source cannot be read, the result should not be cached then
+    std::string MakeKey(const std::vector<std::string>& sourcePaths, const std::string& parameters);
+
+    // Maps the entry into volume on a hit and marks it as recently used
+    bool Find(const std::string& key, VolumeFile& volume);
+    // Written to a temporary file and renamed into place, failures are logged and ignored
+    void Store(const std::string& key, const VolumeHeader& header, const void* data);
+
+    DerivedDataStats GetStats() const;
+    void PrintStats() const;
+
+    // "<project>/cache"
+    static DerivedDataCache& Get();
+
+private:
+    struct SourceHash {
+        uint64_t size;
+        int64_t writeTime;
+        uint64_t hash;
+    };
+
+    std::string GetEntryPath(const std::string& key) const;
+    // Content hash of a source file, reused while its size and write time are unchanged
+    bool HashSource(const std::string& path, uint64_t& hash);
+    void LoadSourceHashes();
+    void SaveSourceHashes();
+    void Trim();
+
+    std::string directory;
+    uint64_t maxBytes;
+
+    mutable std::mutex mutex;
+    std::map<std::string, SourceHash> sourceHashes;
+    bool sourceHashesChanged = false;
+    DerivedDataStats stats;
+};
@@ -147,11 +147,19 @@ void Descriptor::CreateComputeNubisCubedImagesDescriptorSetLayout(VkDevice logic
     cloudDetailNoiseLayoutBinding.pImmutableSamplers = nullptr;
     cloudDetailNoiseLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
+    VkDescriptorSetLayoutBinding sparseVolumeLayoutBinding = {};
+    sparseVolumeLayoutBinding.binding = 3;
+    sparseVolumeLayoutBinding.descriptorCount = 1;
+    sparseVolumeLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    sparseVolumeLayoutBinding.pImmutableSamplers = nullptr;
+    sparseVolumeLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
     std::vector<VkDescriptorSetLayoutBinding> bindings = {
         modelingParkourLayoutBinding, // modelingNVDF
         modelingStormBirdLayoutBinding, // modelingNVDF
         // fieldNVDFLayoutBinding, // fieldNVDF
         cloudDetailNoiseLayoutBinding, // cloudDetailNoise
+        sparseVolumeLayoutBinding, // NanoVDB modeling grids
     };
 
     // Create the descriptor set layout
@@ -245,7 +253,7 @@ void Descriptor::CreateSceneDescriptorSetLayout(VkDevice logicalDevice) {
     }
 }
 
-void Descriptor::CreateDescriptorPool(VkDevice logicalDevice, Scene* scene) {
+void Descriptor::CreateDescriptorPool(VkDevice logicalDevice, Scene* scene, uint32_t frameCount) {
     // Describe which descriptor types that the descriptor sets will contain
     std::vector<VkDescriptorPoolSize> poolSizes = {
         // Image Storage (prev, cur)
@@ -263,18 +271,24 @@ void Descriptor::CreateDescriptorPool(VkDevice logicalDevice, Scene* scene) {
         // Image samplers: compute images: lowres, hires, weather map
         { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5},
 
-        // Camera, PrevCamera, Parameter
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
+        // Camera, PrevCamera, Parameter per frame in flight
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 * frameCount},
 
-        // Time(Scene)Buffer
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}, 
+        // Time(Scene)Buffer per frame in flight
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount}, 
 
-        // UI Control Buffer
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+        // UI Control Buffer per frame in flight
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount},
 
         // Compute nubis cubed images: modelingNVDF, fieldNVDF x 2, cloudDetailNoise
 		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
 
+        // Volume sequence: the compute nubis cubed set once per sequence texture
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6},
+
+        // Sparse volume: the compute nubis cubed set and the two sequence sets
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+
         // Near Cloud
         { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
         { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
@@ -287,7 +301,7 @@ void Descriptor::CreateDescriptorPool(VkDevice logicalDevice, Scene* scene) {
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 15; // TODO: check
+    poolInfo.maxSets = 17 + 3 * (frameCount - 1); // TODO: check
 
     if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create descriptor pool");
@@ -308,6 +322,10 @@ void Descriptor::CreateImageStorageDescriptorSet(VkDevice logicalDevice, Texture
 		throw std::runtime_error("Failed to allocate descriptor set");
 	}
 
+	UpdateImageStorageDescriptorSet(logicalDevice, texture, imageDescriptorSet);
+}
+
+void Descriptor::UpdateImageStorageDescriptorSet(VkDevice logicalDevice, Texture* texture, VkDescriptorSet imageDescriptorSet) {
 	// Configure the descriptors to refer to buffers
 	VkDescriptorImageInfo imageInfo = {};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
@@ -344,6 +362,10 @@ void Descriptor::CreateImageDescriptorSet(VkDevice logicalDevice, Texture* textu
 		throw std::runtime_error("Failed to allocate descriptor set");
 	}
 
+	UpdateImageDescriptorSet(logicalDevice, texture, imageDescriptorSet);
+}
+
+void Descriptor::UpdateImageDescriptorSet(VkDevice logicalDevice, Texture* texture, VkDescriptorSet imageDescriptorSet) {
 	// Configure the descriptors to refer to buffers
 	VkDescriptorImageInfo imageInfo = {};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL; //VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -365,7 +387,7 @@ void Descriptor::CreateImageDescriptorSet(VkDevice logicalDevice, Texture* textu
 	vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
-void Descriptor::CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camera) {
+void Descriptor::CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camera, uint32_t frame, VkDescriptorSet& descriptorSet) {
     // Describe the desciptor set
     VkDescriptorSetLayout layouts[] = { cameraDescriptorSetLayout };
     VkDescriptorSetAllocateInfo allocInfo = {};
@@ -375,29 +397,29 @@ void Descriptor::CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camer
     allocInfo.pSetLayouts = layouts;
 
     // Allocate descriptor sets
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &cameraDescriptorSet) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate descriptor set");
     }
 
     // Configure the descriptors to refer to buffers
     VkDescriptorBufferInfo cameraBufferInfo = {};
-    cameraBufferInfo.buffer = camera->GetBuffer();
+    cameraBufferInfo.buffer = camera->GetBuffer(frame);
     cameraBufferInfo.offset = 0;
     cameraBufferInfo.range = sizeof(CameraBufferObject);
 
     VkDescriptorBufferInfo prevCameraBufferInfo = {};
-    prevCameraBufferInfo.buffer = camera->GetPrevBuffer();
+    prevCameraBufferInfo.buffer = camera->GetPrevBuffer(frame);
     prevCameraBufferInfo.offset = 0;
     prevCameraBufferInfo.range = sizeof(CameraBufferObject);
 
     VkDescriptorBufferInfo paramBufferInfo = {};
-    prevCameraBufferInfo.buffer = camera->GetCameraParamBuffer();
-    prevCameraBufferInfo.offset = 0;
-    prevCameraBufferInfo.range = sizeof(CameraParamBufferObject);
+    paramBufferInfo.buffer = camera->GetCameraParamBuffer(frame);
+    paramBufferInfo.offset = 0;
+    paramBufferInfo.range = sizeof(CameraParamBufferObject);
 
     std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = cameraDescriptorSet;
+    descriptorWrites[0].dstSet = descriptorSet;
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
     descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -407,7 +429,7 @@ void Descriptor::CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camer
     descriptorWrites[0].pTexelBufferView = nullptr;
 
     descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = cameraDescriptorSet;
+    descriptorWrites[1].dstSet = descriptorSet;
     descriptorWrites[1].dstBinding = 1;
     descriptorWrites[1].dstArrayElement = 0;
     descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -417,12 +439,12 @@ void Descriptor::CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camer
     descriptorWrites[1].pTexelBufferView = nullptr;
 
     descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[2].dstSet = cameraDescriptorSet;
+    descriptorWrites[2].dstSet = descriptorSet;
     descriptorWrites[2].dstBinding = 2;
     descriptorWrites[2].dstArrayElement = 0;
     descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     descriptorWrites[2].descriptorCount = 1;
-    descriptorWrites[2].pBufferInfo = &prevCameraBufferInfo;
+    descriptorWrites[2].pBufferInfo = &paramBufferInfo;
     descriptorWrites[2].pImageInfo = nullptr;
     descriptorWrites[2].pTexelBufferView = nullptr;
 
@@ -445,6 +467,11 @@ void Descriptor::CreateComputeImagesDescriptorSet(VkDevice logicalDevice,
 		throw std::runtime_error("Failed to allocate descriptor set");
 	}
 
+    UpdateComputeImagesDescriptorSet(logicalDevice, lowResTex, hiResTex, weatherMap, curlNoise);
+}
+
+void Descriptor::UpdateComputeImagesDescriptorSet(VkDevice logicalDevice,
+    Texture* lowResTex, Texture* hiResTex, Texture* weatherMap, Texture* curlNoise) {
 	// Configure the descriptors to refer to buffers
 	VkDescriptorImageInfo lowResImageInfo = {};
 	lowResImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -517,6 +544,10 @@ void Descriptor::CreateComputeImagesDescriptorSet(VkDevice logicalDevice,
 }
 
 void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice, Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex) {
+    CreateComputeNubisCubedImagesDescriptorSet(logicalDevice, modelingParkour, modelingStormBird, cloudDetailNoiseTex, computeNubisCubedImagesDescriptorSet);
+}
+
+void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice, Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex, VkDescriptorSet& descriptorSet) {
     // Describe the desciptor set
     VkDescriptorSetLayout layouts[] = { computeNubisCubedImagesDescriptorSetLayout };
     VkDescriptorSetAllocateInfo allocInfo = {};
@@ -526,10 +557,18 @@ void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevi
     allocInfo.pSetLayouts = layouts;
 
     // Allocate descriptor sets
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &computeNubisCubedImagesDescriptorSet) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate descriptor set");
     }
 
+    UpdateComputeNubisCubedImagesDescriptorSet(logicalDevice, modelingParkour, modelingStormBird, cloudDetailNoiseTex, descriptorSet);
+}
+
+void Descriptor::UpdateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice, Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex) {
+    UpdateComputeNubisCubedImagesDescriptorSet(logicalDevice, modelingParkour, modelingStormBird, cloudDetailNoiseTex, computeNubisCubedImagesDescriptorSet);
+}
+
+void Descriptor::UpdateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice, Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex, VkDescriptorSet descriptorSet) {
     // Configure the descriptors to refer to buffers
     VkDescriptorImageInfo modelingParkourImageInfo = {};
     modelingParkourImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -553,7 +592,7 @@ void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevi
 
     std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = computeNubisCubedImagesDescriptorSet;
+    descriptorWrites[0].dstSet = descriptorSet;
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
     descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -563,7 +602,7 @@ void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevi
     descriptorWrites[0].pTexelBufferView = nullptr;
 
     descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = computeNubisCubedImagesDescriptorSet;
+    descriptorWrites[1].dstSet = descriptorSet;
     descriptorWrites[1].dstBinding = 1;
     descriptorWrites[1].dstArrayElement = 0;
     descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -583,7 +622,7 @@ void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevi
     // descriptorWrites[1].pTexelBufferView = nullptr;
 
     descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[2].dstSet = computeNubisCubedImagesDescriptorSet;
+    descriptorWrites[2].dstSet = descriptorSet;
     descriptorWrites[2].dstBinding = 2;
     descriptorWrites[2].dstArrayElement = 0;
     descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -596,7 +635,27 @@ void Descriptor::CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevi
     vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
-void Descriptor::CreateSceneDescriptorSet(VkDevice logicalDevice, Scene* scene) {
+void Descriptor::UpdateSparseVolumeDescriptorSet(VkDevice logicalDevice, VkBuffer sparseVolume, VkDescriptorSet descriptorSet) {
+    VkDescriptorBufferInfo sparseVolumeBufferInfo = {};
+    sparseVolumeBufferInfo.buffer = sparseVolume;
+    sparseVolumeBufferInfo.offset = 0;
+    sparseVolumeBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 3;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &sparseVolumeBufferInfo;
+    descriptorWrite.pImageInfo = nullptr;
+    descriptorWrite.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+void Descriptor::CreateSceneDescriptorSet(VkDevice logicalDevice, Scene* scene, uint32_t frame, VkDescriptorSet& descriptorSet) {
     // Describe the desciptor set
     VkDescriptorSetLayout layouts[] = { sceneDescriptorSetLayout };
     VkDescriptorSetAllocateInfo allocInfo = {};
@@ -606,19 +665,19 @@ void Descriptor::CreateSceneDescriptorSet(VkDevice logicalDevice, Scene* scene)
     allocInfo.pSetLayouts = layouts;
 
     // Allocate descriptor sets
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &sceneDescriptorSet) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate descriptor set");
     }
 
     // Configure the descriptors to refer to buffers
     VkDescriptorBufferInfo sceneBufferInfo = {};
-    sceneBufferInfo.buffer = scene->GetTimeBuffer();
+    sceneBufferInfo.buffer = scene->GetTimeBuffer(frame);
     sceneBufferInfo.offset = 0;
     sceneBufferInfo.range = sizeof(Time);
 
     std::array<VkWriteDescriptorSet, 1> descriptorWrites = {};
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = sceneDescriptorSet;
+    descriptorWrites[0].dstSet = descriptorSet;
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
     descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -631,7 +690,7 @@ void Descriptor::CreateSceneDescriptorSet(VkDevice logicalDevice, Scene* scene)
     vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
-void Descriptor::CreateUIParamDescriptorSet(VkDevice logicalDevice, VkBuffer& uiControlBufferObject, VkDeviceSize size) {
+void Descriptor::CreateUIParamDescriptorSet(VkDevice logicalDevice, VkBuffer& uiControlBufferObject, VkDeviceSize size, VkDescriptorSet& descriptorSet) {
     // Describe the desciptor set
 	VkDescriptorSetLayout layouts[] = { uiParamDescriptorSetLayout };
 	VkDescriptorSetAllocateInfo allocInfo = {};
@@ -641,7 +700,7 @@ void Descriptor::CreateUIParamDescriptorSet(VkDevice logicalDevice, VkBuffer& ui
 	allocInfo.pSetLayouts = layouts;
 
 	// Allocate descriptor sets
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &uiParamDescriptorSet) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to allocate descriptor set");
 	}
 
@@ -653,7 +712,7 @@ void Descriptor::CreateUIParamDescriptorSet(VkDevice logicalDevice, VkBuffer& ui
 
 	std::array<VkWriteDescriptorSet, 1> descriptorWrites = {};
 	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[0].dstSet = uiParamDescriptorSet;
+	descriptorWrites[0].dstSet = descriptorSet;
 	descriptorWrites[0].dstBinding = 0;
 	descriptorWrites[0].dstArrayElement = 0;
 	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -18,17 +18,34 @@ namespace Descriptor {
     void CreateCameraDescriptorSetLayout(VkDevice logicalDevice);
     void CreateSceneDescriptorSetLayout(VkDevice logicalDevice);
 
-    void CreateDescriptorPool(VkDevice logicalDevice, Scene* scene);
+    // The camera, scene and UI sets are allocated once per frame in flight
+    void CreateDescriptorPool(VkDevice logicalDevice, Scene* scene, uint32_t frameCount = 1);
 
     void CreateImageStorageDescriptorSet(VkDevice logicalDevice, Texture* texture, VkDescriptorSet& imageDescriptorSet);
     void CreateImageDescriptorSet(VkDevice logicalDevice, Texture* texture, VkDescriptorSet& imageDescriptorSet);
-    void CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camera);
+    // Rewrite an existing set in place, e.g. after its texture was recreated for a new swapchain extent
+    void UpdateImageStorageDescriptorSet(VkDevice logicalDevice, Texture* texture, VkDescriptorSet imageDescriptorSet);
+    void UpdateImageDescriptorSet(VkDevice logicalDevice, Texture* texture, VkDescriptorSet imageDescriptorSet);
+    // Sets over the uniform buffers of one frame in flight
+    void CreateCameraDescriptorSet(VkDevice logicalDevice, Camera* camera, uint32_t frame, VkDescriptorSet& descriptorSet);
     void CreateComputeImagesDescriptorSet(VkDevice logicalDevice, 
         Texture* lowResTex, Texture* hiResTex, Texture* weatherMap, Texture* curlNoise);
     void CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice, 
         Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex);
-    void CreateSceneDescriptorSet(VkDevice logicalDevice, Scene* scene);
-    void CreateUIParamDescriptorSet(VkDevice logicalDevice, VkBuffer& uiControlBufferObject, VkDeviceSize size);
+    // Additional sets with the same layout, e.g. one per volume sequence texture
+    void CreateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice,
+        Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex, VkDescriptorSet& descriptorSet);
+    // Point the compute sets at new textures, e.g. when a streamed volume replaces its placeholder
+    void UpdateComputeImagesDescriptorSet(VkDevice logicalDevice,
+        Texture* lowResTex, Texture* hiResTex, Texture* weatherMap, Texture* curlNoise);
+    void UpdateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice,
+        Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex);
+    void UpdateComputeNubisCubedImagesDescriptorSet(VkDevice logicalDevice,
+        Texture* modelingParkour, Texture* modelingStormBird, Texture* cloudDetailNoiseTex, VkDescriptorSet descriptorSet);
+    // Binding 3 of a compute nubis cubed set, the NanoVDB grids of a SparseVolume (or a placeholder buffer)
+    void UpdateSparseVolumeDescriptorSet(VkDevice logicalDevice, VkBuffer sparseVolume, VkDescriptorSet descriptorSet);
+    void CreateSceneDescriptorSet(VkDevice logicalDevice, Scene* scene, uint32_t frame, VkDescriptorSet& descriptorSet);
+    void CreateUIParamDescriptorSet(VkDevice logicalDevice, VkBuffer& uiControlBufferObject, VkDeviceSize size, VkDescriptorSet& descriptorSet);
 
     void CleanUp(VkDevice logicalDevice);
 
@@ -53,8 +70,9 @@ namespace Descriptor {
     extern VkDescriptorSet nearCloudColorSamplerDescriptorSet;
     extern VkDescriptorSet nearCloudDensityDescriptorSet;
     extern VkDescriptorSet nearCloudDensitySamplerDescriptorSet;
-    extern VkDescriptorSet uiParamDescriptorSet;
 
+    // The shader programs bind these, the renderer points them at the sets of the frame it records
+    extern VkDescriptorSet uiParamDescriptorSet;
     extern VkDescriptorSet cameraDescriptorSet;
     extern VkDescriptorSet sceneDescriptorSet;
 }
\ No newline at end of file
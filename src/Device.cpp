@@ -1,8 +1,15 @@
 #include "Device.h"
 #include "Instance.h"
+#include "Trace.h"
 
-Device::Device(Instance* instance, VkPhysicalDevice vkPhysicalDevice, VkDevice vkDevice, Queues queues)
-  : instance(instance), vkPhysicalDevice(vkPhysicalDevice), vkDevice(vkDevice), queues(queues) {
+Device::Device(Instance* instance, VkPhysicalDevice vkPhysicalDevice, VkDevice vkDevice, Queues queues, VkPhysicalDeviceFeatures enabledFeatures)
+  : instance(instance), vkPhysicalDevice(vkPhysicalDevice), vkDevice(vkDevice), queues(queues), enabledFeatures(enabledFeatures) {
+    const QueueFamilyIndices& indices = instance->GetQueueFamilyIndices();
+    sharedQueueFamilies.push_back(indices[QueueFlags::Graphics]);
+    if (indices[QueueFlags::Compute] != indices[QueueFlags::Graphics]) {
+        sharedQueueFamilies.push_back(indices[QueueFlags::Compute]);
+    }
+    allocator = new MemoryAllocator(this);
 }
 
 Instance* Device::GetInstance() {
@@ -21,10 +28,16 @@ unsigned int Device::GetQueueIndex(QueueFlags flag) {
     return GetInstance()->GetQueueFamilyIndices()[flag];
 }
 
+MemoryAllocator* Device::GetAllocator() {
+    return allocator;
+}
+
 SwapChain* Device::CreateSwapChain(VkSurfaceKHR surface, unsigned int numBuffers) {
+    TRACE_ZONE("Device::CreateSwapChain");
     return new SwapChain(this, surface, numBuffers);
 }
 
 Device::~Device() {
+    delete allocator;
     vkDestroyDevice(vkDevice, nullptr);
 }
@@ -2,9 +2,11 @@
 
 #include <array>
 #include <stdexcept>
+#include <vector>
 #include <vulkan/vulkan.h>
 #include "QueueFlags.h"
 #include "SwapChain.h"
+#include "MemoryAllocator.h"
 
 class SwapChain;
 class Device {
@@ -16,16 +18,24 @@ public:
     VkDevice GetVkDevice();
     VkQueue GetQueue(QueueFlags flag);
     unsigned int GetQueueIndex(QueueFlags flag);
+    // The graphics and compute families, one entry if they are the same. Images and buffers both
+    // queues use are created concurrent across them, so they need no ownership transfers.
+    const std::vector<uint32_t>& GetSharedQueueFamilies() const { return sharedQueueFamilies; }
+    MemoryAllocator* GetAllocator();
+    const VkPhysicalDeviceFeatures& GetEnabledFeatures() const { return enabledFeatures; }
     ~Device();
 
 private:
     using Queues = std::array<VkQueue, sizeof(QueueFlags)>;
     
     Device() = delete;
-    Device(Instance* instance, VkPhysicalDevice vkPhysicalDevice, VkDevice vkDevice, Queues queues);
+    Device(Instance* instance, VkPhysicalDevice vkPhysicalDevice, VkDevice vkDevice, Queues queues, VkPhysicalDeviceFeatures enabledFeatures);
 
     Instance* instance;
     VkDevice vkDevice;
     VkPhysicalDevice vkPhysicalDevice;
     Queues queues;
+    VkPhysicalDeviceFeatures enabledFeatures;
+    std::vector<uint32_t> sharedQueueFamilies;
+    MemoryAllocator* allocator;
 };
@@ -0,0 +1,215 @@
+#include "GpuProfiler.h"
+#include "Instance.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+GpuProfiler::GpuProfiler(Device* device, uint32_t frameCount)
+  : device(device), frames(frameCount) {
+    VkPhysicalDevice physicalDevice = device->GetInstance()->GetPhysicalDevice();
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    deviceName = properties.deviceName;
+    driverVersion = properties.driverVersion;
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = std::min(queueFamilies[device->GetQueueIndex(QueueFlags::Graphics)].timestampValidBits,
+                                  queueFamilies[device->GetQueueIndex(QueueFlags::Compute)].timestampValidBits);
+    supported = validBits > 0;
+    if (!supported) {
+        return;
+    }
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    pipelineStatistics = device->GetEnabledFeatures().pipelineStatisticsQuery == VK_TRUE;
+
+    for (FramePools& pools : frames) {
+        VkQueryPoolCreateInfo timestampInfo = {};
+        timestampInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        timestampInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        timestampInfo.queryCount = GpuPassCount * 2;
+        if (vkCreateQueryPool(device->GetVkDevice(), &timestampInfo, nullptr, &pools.timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool");
+        }
+
+        if (pipelineStatistics) {
+            // Graphics statistics may only be queried on a graphics queue, so each queue gets its own pool
+            VkQueryPoolCreateInfo statisticsInfo = {};
+            statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            statisticsInfo.queryCount = PostPass;
+            statisticsInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+            if (vkCreateQueryPool(device->GetVkDevice(), &statisticsInfo, nullptr, &pools.computeStatisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline statistics query pool");
+            }
+
+            statisticsInfo.queryCount = GpuPassCount - PostPass;
+            statisticsInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+            if (vkCreateQueryPool(device->GetVkDevice(), &statisticsInfo, nullptr, &pools.graphicsStatisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline statistics query pool");
+            }
+        }
+    }
+
+    for (std::vector<float>& samples : history) {
+        samples.reserve(HISTORY_SIZE);
+    }
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (FramePools& pools : frames) {
+        vkDestroyQueryPool(device->GetVkDevice(), pools.timestampPool, nullptr);
+        vkDestroyQueryPool(device->GetVkDevice(), pools.computeStatisticsPool, nullptr);
+        vkDestroyQueryPool(device->GetVkDevice(), pools.graphicsStatisticsPool, nullptr);
+    }
+}
+
+void GpuProfiler::RecordReset(VkCommandBuffer commandBuffer, uint32_t frame, bool compute) {
+    if (!supported) {
+        return;
+    }
+    FramePools& pools = frames[frame];
+    uint32_t first = compute ? 0 : PostPass;
+    uint32_t count = compute ? PostPass : GpuPassCount - PostPass;
+    vkCmdResetQueryPool(commandBuffer, pools.timestampPool, first * 2, count * 2);
+    if (pipelineStatistics) {
+        vkCmdResetQueryPool(commandBuffer, compute ? pools.computeStatisticsPool : pools.graphicsStatisticsPool, 0, count);
+    }
+}
+
+void GpuProfiler::RecordBegin(VkCommandBuffer commandBuffer, uint32_t frame, GpuPass pass) {
+    if (!supported) {
+        return;
+    }
+    FramePools& pools = frames[frame];
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pools.timestampPool, pass * 2);
+    if (pipelineStatistics) {
+        bool compute = IsComputePass(pass);
+        vkCmdBeginQuery(commandBuffer, compute ? pools.computeStatisticsPool : pools.graphicsStatisticsPool, compute ? pass : pass - PostPass, 0);
+    }
+}
+
+void GpuProfiler::RecordEnd(VkCommandBuffer commandBuffer, uint32_t frame, GpuPass pass) {
+    if (!supported) {
+        return;
+    }
+    FramePools& pools = frames[frame];
+    if (pipelineStatistics) {
+        bool compute = IsComputePass(pass);
+        vkCmdEndQuery(commandBuffer, compute ? pools.computeStatisticsPool : pools.graphicsStatisticsPool, compute ? pass : pass - PostPass);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pools.timestampPool, pass * 2 + 1);
+}
+
+void GpuProfiler::MarkSubmitted(uint32_t frame) {
+    frames[frame].submitted = supported;
+}
+
+void GpuProfiler::Collect(uint32_t frame) {
+    FramePools& pools = frames[frame];
+    if (!pools.submitted) {
+        return;
+    }
+    pools.submitted = false;
+
+    // The fence covers every query of the slot, but passes that were not recorded (the UI of headless runs)
+    // stay unavailable after the reset. Every pass is read with its availability and only those are skipped.
+    VkDevice logicalDevice = device->GetVkDevice();
+    const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+    for (uint32_t pass = 0; pass < GpuPassCount; ++pass) {
+        // Begin and end timestamp, each followed by its availability
+        uint64_t timestamps[4] = {};
+        vkGetQueryPoolResults(logicalDevice, pools.timestampPool, pass * 2, 2, sizeof(timestamps), timestamps,
+                              2 * sizeof(uint64_t), flags);
+        if (timestamps[1] == 0 || timestamps[3] == 0) {
+            continue;
+        }
+
+        uint64_t ticks = (timestamps[2] - timestamps[0]) & timestampMask;
+        float milliseconds = static_cast<float>(ticks * timestampPeriod * 1e-6);
+        if (history[pass].size() < HISTORY_SIZE) {
+            history[pass].push_back(milliseconds);
+        } else {
+            history[pass][historyNext[pass]] = milliseconds;
+        }
+        historyNext[pass] = (historyNext[pass] + 1) % HISTORY_SIZE;
+
+        if (pipelineStatistics) {
+            bool compute = IsComputePass(static_cast<GpuPass>(pass));
+            uint64_t statistics[2] = {};
+            vkGetQueryPoolResults(logicalDevice, compute ? pools.computeStatisticsPool : pools.graphicsStatisticsPool,
+                                  compute ? pass : pass - PostPass, 1, sizeof(statistics), statistics, sizeof(statistics), flags);
+            if (statistics[1] != 0) {
+                invocations[pass] = statistics[0];
+            }
+        }
+    }
+}
+
+const char* GpuProfiler::GetPassName(GpuPass pass) {
+    switch (pass) {
+        case LightGridPass: return "Light Grid";
+        case NearCloudPass: return "Near Clouds";
+        case FarCloudPass: return "Far Clouds";
+        case PostPass: return "Tone/Godray";
+        case UIPass: return "ImGui";
+        default: return "Unknown";
+    }
+}
+
+GpuProfiler::PassStats GpuProfiler::GetStats(GpuPass pass) const {
+    PassStats stats;
+    stats.invocations = invocations[pass];
+    std::vector<float> sorted = history[pass];
+    if (sorted.empty()) {
+        return stats;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (float milliseconds : sorted) {
+        sum += milliseconds;
+    }
+    // Nearest rank
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return static_cast<double>(sorted[rank]);
+    };
+
+    stats.samples = static_cast<uint32_t>(sorted.size());
+    stats.averageMilliseconds = sum / sorted.size();
+    stats.p50Milliseconds = percentile(0.50);
+    stats.p95Milliseconds = percentile(0.95);
+    stats.p99Milliseconds = percentile(0.99);
+    stats.maxMilliseconds = sorted.back();
+    return stats;
+}
+
+bool GpuProfiler::WriteCsv(const std::string& path) const {
+    bool exists = std::ifstream(path).good();
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        return false;
+    }
+
+    if (!exists) {
+        file << "device,driver_version,pass,samples,average_ms,p50_ms,p95_ms,p99_ms,max_ms,invocations\n";
+    }
+    for (uint32_t pass = 0; pass < GpuPassCount; ++pass) {
+        PassStats stats = GetStats(static_cast<GpuPass>(pass));
+        if (stats.samples == 0) {
+            continue;
+        }
+        file << '"' << deviceName << "\"," << driverVersion << ',' << GetPassName(static_cast<GpuPass>(pass)) << ','
+            << stats.samples << ',' << stats.averageMilliseconds << ',' << stats.p50Milliseconds << ','
+            << stats.p95Milliseconds << ',' << stats.p99Milliseconds << ',' << stats.maxMilliseconds << ','
+            << stats.invocations << '\n';
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Device.h"
+
+enum GpuPass {
+    LightGridPass,
+    NearCloudPass,
+    FarCloudPass,
+    PostPass,
+    UIPass,
+    GpuPassCount,
+};
+
+// GPU time of each pass from timestamp queries, plus the shader invocations it ran where the device supports
+// pipeline statistics queries. Every frame slot writes its own query pools, which are read once the slot's fence
+// has signaled, so the results are a few frames old but never waited for.
+//
+// The compute passes reset their queries in the first compute command buffer of the frame, the graphics passes
+// in the primary before the render pass. Everything is a no-op if either queue family has no timestamps.
+class GpuProfiler {
+public:
+    // Samples kept per pass for the averages and percentiles
+    static constexpr uint32_t HISTORY_SIZE = 240;
+
+    struct PassStats {
+        uint32_t samples = 0;
+        double averageMilliseconds = 0.0;
+        double p50Milliseconds = 0.0;
+        double p95Milliseconds = 0.0;
+        double p99Milliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+        // Compute or fragment shader invocations of the last collected frame, 0 without statistics queries
+        uint64_t invocations = 0;
+    };
+
+    GpuProfiler(Device* device, uint32_t frameCount);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    bool IsSupported() const { return supported; }
+    bool HasPipelineStatistics() const { return pipelineStatistics; }
+
+    // Resets the queries of the compute passes or of the graphics passes, outside a render pass
+    void RecordReset(VkCommandBuffer commandBuffer, uint32_t frame, bool compute);
+    void RecordBegin(VkCommandBuffer commandBuffer, uint32_t frame, GpuPass pass);
+    void RecordEnd(VkCommandBuffer commandBuffer, uint32_t frame, GpuPass pass);
+
+    // Call after the frame slot's graphics submission
+    void MarkSubmitted(uint32_t frame);
+    // Call after waiting on the frame slot's fence, adds its results to the history
+    void Collect(uint32_t frame);
+
+    static const char* GetPassName(GpuPass pass);
+    PassStats GetStats(GpuPass pass) const;
+
+    // Appends one row per pass that has samples (headless runs have no UI pass), with the device and driver so runs on different machines can share a file.
+    // Returns false if the file cannot be opened.
+    bool WriteCsv(const std::string& path) const;
+
+private:
+    struct FramePools {
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        VkQueryPool computeStatisticsPool = VK_NULL_HANDLE;
+        VkQueryPool graphicsStatisticsPool = VK_NULL_HANDLE;
+        bool submitted = false;
+    };
+
+    static bool IsComputePass(GpuPass pass) { return pass < PostPass; }
+
+    Device* device;
+    bool supported = false;
+    bool pipelineStatistics = false;
+    // Nanoseconds per timestamp tick
+    double timestampPeriod = 1.0;
+    uint64_t timestampMask = ~0ull;
+    std::string deviceName;
+    uint32_t driverVersion = 0;
+
+    std::vector<FramePools> frames;
+
+    // Ring buffers of milliseconds per pass
+    std::vector<float> history[GpuPassCount];
+    uint32_t historyNext[GpuPassCount] = {};
+    uint64_t invocations[GpuPassCount] = {};
+};
@@ -6,11 +6,21 @@
 #include "Device.h"
 #include "Instance.h"
 #include "BufferUtils.h"
-
+#include "DerivedDataCache.h"
+#include "UploadBatch.h"
+#include "TgaReader.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "VolumeFile.h"
+
+#include <cstring>
+#include <filesystem>
 #include <string>
 #include <iostream>
+#include <chrono>
 
-void Image::Create(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void Image::Create(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory, bool exclusive) {
+    TRACE_ZONE("Image::Create");
     // Create Vulkan image
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -25,30 +35,23 @@ void Image::Create(Device* device, uint32_t width, uint32_t height, VkFormat for
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = usage;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    const std::vector<uint32_t>& queueFamilies = device->GetSharedQueueFamilies();
+    imageInfo.sharingMode = !exclusive && queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+    if (imageInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        imageInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
 
     if (vkCreateImage(device->GetVkDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create image");
     }
 
-    // Allocate memory for the image
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device->GetVkDevice(), image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = device->GetInstance()->GetMemoryTypeIndex(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device->GetVkDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate image memory");
-    }
-
-    // Bind the image
-    vkBindImageMemory(device->GetVkDevice(), image, imageMemory, 0);
+    // Sub-allocate memory for the image from the device's pools and bind it
+    imageMemory = device->GetAllocator()->AllocateForImage(image, tiling, properties);
 }
 
-void Image::Create3D(Device* device, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void Image::Create3D(Device* device, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory) {
+    TRACE_ZONE("Image::Create3D");
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_3D;
@@ -62,30 +65,21 @@ void Image::Create3D(Device* device, glm::ivec3 dimension, VkFormat format, VkIm
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = usage;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    // Volumes are uploaded on the graphics queue and sampled by the compute passes
+    const std::vector<uint32_t>& queueFamilies = device->GetSharedQueueFamilies();
+    imageInfo.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+    imageInfo.pQueueFamilyIndices = queueFamilies.data();
 
     if (vkCreateImage(device->GetVkDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create image");
     }
 
-    // Allocate memory for the image
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device->GetVkDevice(), image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = device->GetInstance()->GetMemoryTypeIndex(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device->GetVkDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate image memory");
-    }
-
-    // Bind the image
-    vkBindImageMemory(device->GetVkDevice(), image, imageMemory, 0);
+    // Sub-allocate memory for the image from the device's pools and bind it
+    imageMemory = device->GetAllocator()->AllocateForImage(image, tiling, properties);
 }
 
-void Image::TransitionLayout(Device* device, VkCommandPool commandPool, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+void Image::RecordTransitionLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
     auto hasStencilComponent = [](VkFormat format) {
         return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
   };
@@ -152,33 +146,13 @@ void Image::TransitionLayout(Device* device, VkCommandPool commandPool, VkImage
         throw std::invalid_argument("Unsupported layout transition");
     }
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device->GetVkDevice(), &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-  
     vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-  
-    vkEndCommandBuffer(commandBuffer);
-    
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(device->GetQueue(QueueFlags::Graphics), 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(device->GetQueue(QueueFlags::Graphics));
-    vkFreeCommandBuffers(device->GetVkDevice(), commandPool, 1, &commandBuffer);
+}
+
+void Image::TransitionLayout(Device* device, VkCommandPool commandPool, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+    UploadBatch batch(device, commandPool);
+    batch.TransitionLayout(image, format, oldLayout, newLayout);
+    batch.Submit();
 }
 
 VkImageView Image::CreateView(Device* device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType) {
@@ -230,7 +204,7 @@ VkSampler Image::CreateSampler(Device* device) {
     return textureSampler;
 }
 
-void Image::CopyFromBuffer(Device* device, VkCommandPool commandPool, VkBuffer buffer, VkImage& image, uint32_t width, uint32_t height, uint32_t depth) {
+void Image::RecordCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth) {
     // Specify which part of the buffer is going to be copied to which part of the image
     VkBufferImageCopy region = {};
     region.bufferOffset = 0;
@@ -245,36 +219,17 @@ void Image::CopyFromBuffer(Device* device, VkCommandPool commandPool, VkBuffer b
     region.imageOffset = { 0, 0, 0 };
     region.imageExtent = { width, height, depth };
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device->GetVkDevice(), &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(device->GetQueue(QueueFlags::Transfer), 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(device->GetQueue(QueueFlags::Transfer));
-    vkFreeCommandBuffers(device->GetVkDevice(), commandPool, 1, &commandBuffer);
+void Image::CopyFromBuffer(Device* device, VkCommandPool commandPool, VkBuffer buffer, VkImage& image, uint32_t width, uint32_t height, uint32_t depth) {
+    UploadBatch batch(device, commandPool);
+    batch.CopyBufferToImage(buffer, image, width, height, depth);
+    batch.Submit();
 }
 
-void Image::FromFile(Device* device, VkCommandPool commandPool, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void Image::FromFile(Device* device, UploadBatch& batch, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory) {
+    TRACE_ZONE("Image::FromFile", path);
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(path, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     VkDeviceSize imageSize = texWidth * texHeight * 4;
@@ -282,20 +237,12 @@ void Image::FromFile(Device* device, VkCommandPool commandPool, const char* path
     if (!pixels) {
         throw std::runtime_error("Failed to load texture image");
     }
+    Trace::AddFileRead(path);
 
-    // Create staging buffer
+    // Copy pixel values to a staging buffer owned by the batch
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    BufferUtils::CreateBuffer(device, imageSize, stagingUsage, stagingProperties, stagingBuffer, stagingBufferMemory);
-
-    // Copy pixel values to the buffer
-    void* data;
-    vkMapMemory(device->GetVkDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
+    void* data = batch.CreateStagingBuffer(imageSize, stagingBuffer);
     memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device->GetVkDevice(), stagingBufferMemory);
 
     // Free pixel array
     stbi_image_free(pixels);
@@ -305,120 +252,166 @@ void Image::FromFile(Device* device, VkCommandPool commandPool, const char* path
 
     // Copy the staging buffer to the texture image
     // --> First need to transition the texture image to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    Image::TransitionLayout(device, commandPool, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    Image::CopyFromBuffer(device, commandPool, stagingBuffer, image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1);
+    batch.TransitionLayout(image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    batch.CopyBufferToImage(stagingBuffer, image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1);
 
     // Transition texture image for shader access
-    Image::TransitionLayout(device, commandPool, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
+    batch.TransitionLayout(image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
+}
 
-    // No need for staging buffer anymore
-    vkDestroyBuffer(device->GetVkDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device->GetVkDevice(), stagingBufferMemory, nullptr);
+void Image::DecodeSlices(const char* path, glm::ivec3 dimension, unsigned char* data) {
+    TRACE_ZONE("Image::DecodeSlices", path);
+    auto decodeStart = std::chrono::high_resolution_clock::now();
+
+    VkDeviceSize sliceSize = static_cast<VkDeviceSize>(dimension.x) * dimension.y * 4;
+    VkDeviceSize imageSize = sliceSize * dimension.z;
+
+    std::vector<std::string> slicePaths(dimension.z);
+    for (int i = 0; i < dimension.z; ++i) {
+        slicePaths[i] = path + std::string("(") + std::to_string(i) + ").tga";
+    }
+
+    DerivedDataCache& cache = DerivedDataCache::Get();
+    std::string cacheKey = cache.MakeKey(slicePaths, "tga rgba8 " + std::to_string(dimension.x) + "x" + std::to_string(dimension.y) + "x" + std::to_string(dimension.z));
+    VolumeFile cached;
+    if (!cacheKey.empty() && cache.Find(cacheKey, cached)) {
+        memcpy(data, cached.GetData(), static_cast<size_t>(imageSize));
+
+        std::chrono::duration<double, std::milli> copyTime = std::chrono::high_resolution_clock::now() - decodeStart;
+        std::cout << "Loaded cached " << path << " (" << dimension.x << "x" << dimension.y << "x" << dimension.z << ") in "
+                  << copyTime.count() << " ms" << std::endl;
+        return;
+    }
+
+    ThreadPool& pool = ThreadPool::Get();
+    pool.ParallelFor(static_cast<uint32_t>(dimension.z), [&](uint32_t i) {
+        // Decoded from the mapped file straight into its slice of the staging buffer
+        if (!Tga::LoadRGBA(slicePaths[i], dimension.x, dimension.y, data + i * sliceSize)) {
+            throw std::runtime_error("Failed to load " + std::to_string(dimension.x) + "x" + std::to_string(dimension.y) + " texture image " + slicePaths[i]);
+        }
+    });
+
+    std::chrono::duration<double, std::milli> decodeTime = std::chrono::high_resolution_clock::now() - decodeStart;
+    std::cout << "Decoded " << path << " (" << dimension.x << "x" << dimension.y << "x" << dimension.z << ", "
+              << pool.GetThreadCount() << " threads) in " << decodeTime.count() << " ms" << std::endl;
+
+    if (!cacheKey.empty()) {
+        const VolumeChannel channels[4] = {};
+        cache.Store(cacheKey, VolumeFile::MakeHeader(dimension.x, dimension.y, dimension.z, VK_FORMAT_R8G8B8A8_UNORM, 4, channels), data);
+    }
 }
 
-void Image::FromFiles(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
-    VkDeviceSize imageSize = dimension.x * dimension.y * dimension.z * 4;
-    
-    // Create staging buffer
+void Image::FromFiles(Device* device, UploadBatch& batch, const char* path, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory) {
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(dimension.x) * dimension.y * dimension.z * 4;
+
+    // The staging buffer stays mapped, every slice is decoded into its final offset
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    BufferUtils::CreateBuffer(device, imageSize, stagingUsage, stagingProperties, stagingBuffer, stagingBufferMemory);
-
-    int width, height, channels;
-    for (uint32_t i = 0; i < static_cast<uint32_t>(dimension.z); ++i) {
-        stbi_uc* pixels = stbi_load((path + std::string("(") + std::to_string(i) + ").tga").c_str(), &width, &height, &channels, STBI_rgb_alpha);
-        if (!pixels) {
-            std::cout << "Failed to load texture image" << i << std::endl;
-			throw std::runtime_error("Failed to load texture image");
-		}
-
-        void* data;
-        imageSize = width * height * 4;
-        vkMapMemory(device->GetVkDevice(), stagingBufferMemory, static_cast<uint64_t>(i) * imageSize, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device->GetVkDevice(), stagingBufferMemory);
-
-        stbi_image_free(pixels);
-    }
+    unsigned char* stagingData = static_cast<unsigned char*>(batch.CreateStagingBuffer(imageSize, stagingBuffer));
+    Image::DecodeSlices(path, dimension, stagingData);
 
     // Create Vulkan image
     Image::Create3D(device, dimension, format, tiling, VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage, properties, image, imageMemory);
 
     // Copy the staging buffer to the texture image
-    Image::TransitionLayout(device, commandPool, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	Image::CopyFromBuffer(device, commandPool, stagingBuffer, image, static_cast<uint32_t>(dimension.x), static_cast<uint32_t>(dimension.y), static_cast<uint32_t>(dimension.z)); // TODO: check
+    batch.TransitionLayout(image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    batch.CopyBufferToImage(stagingBuffer, image, static_cast<uint32_t>(dimension.x), static_cast<uint32_t>(dimension.y), static_cast<uint32_t>(dimension.z));
 
     // Transition texture image for shader access
-    Image::TransitionLayout(device, commandPool, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
+    batch.TransitionLayout(image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
+}
+
+void Image::FromVolumeFile(Device* device, UploadBatch& batch, const VolumeFile& volume, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory) {
+    auto copyStart = std::chrono::high_resolution_clock::now();
 
-    // No need for staging buffer anymore
-    vkDestroyBuffer(device->GetVkDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device->GetVkDevice(), stagingBufferMemory, nullptr);
+    const VolumeHeader& header = volume.GetHeader();
+    glm::ivec3 dimension(header.width, header.height, header.depth);
+    VkDeviceSize imageSize = header.dataSize;
+
+    // Texels are stored in upload order, so this is a straight copy out of the mapped file
+    VkBuffer stagingBuffer;
+    void* data = batch.CreateStagingBuffer(imageSize, stagingBuffer);
+    memcpy(data, volume.GetData(), static_cast<size_t>(imageSize));
+
+    std::chrono::duration<double, std::milli> copyTime = std::chrono::high_resolution_clock::now() - copyStart;
+    std::cout << "Loaded packed volume (" << header.width << "x" << header.height << "x" << header.depth << ") in "
+              << copyTime.count() << " ms" << std::endl;
+
+    // Create Vulkan image
+    Image::Create3D(device, dimension, volume.GetFormat(), tiling, VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage, properties, image, imageMemory);
+
+    // Copy the staging buffer to the texture image
+    batch.TransitionLayout(image, volume.GetFormat(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    batch.CopyBufferToImage(stagingBuffer, image, header.width, header.height, header.depth);
+
+    // Transition texture image for shader access
+    batch.TransitionLayout(image, volume.GetFormat(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
 }
 
-void Image::FromVDBFile(Device* device, VkCommandPool commandPool, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+void Image::FromVDBFile(Device* device, UploadBatch& batch, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory)
 {
+    TRACE_ZONE("Image::FromVDBFile", path);
+
+    // The rasterized slices are cached, a hit skips reading the grid entirely. The key hashes the file
+    // VDBLoader reads, which resolves path against the project directory.
+    DerivedDataCache& cache = DerivedDataCache::Get();
+    std::string sourcePath = (std::filesystem::path(PROJECT_DIRECTORY) / path).string();
+    std::string cacheKey = cache.MakeKey({ sourcePath }, "vdb voxels unorm8 format " + std::to_string(format));
+    VolumeFile cached;
+    if (!cacheKey.empty() && cache.Find(cacheKey, cached)) {
+        Image::FromVolumeFile(device, batch, cached, tiling, usage, layout, properties, image, imageMemory);
+        return;
+    }
+
+    // Only the modeling grids are read, the tree statistics and wireframe are skipped
+    VDBLoadOptions options;
+    for (uint32_t c = 0; c < VoxelStore::CHANNEL_COUNT; ++c) {
+        options.gridNames.push_back(VoxelStore::GetChannelName(static_cast<VoxelChannel>(c)));
+    }
+    options.loadTree = false;
+
     VDBLoader* loader = new VDBLoader();
-    loader->Load(path);
-    if (loader->IsVDBLoaded())
+    loader->Load(path, options);
+    if (loader->IsVDBLoaded() && !loader->GetPtr()->mVoxels.IsEmpty())
     {
         std::cout << "VDB loaded" << std::endl;
-        VDB* vdb_ptr = loader->GetPtr();
+        const VoxelStore& voxels = loader->GetPtr()->mVoxels;
 
-        glm::vec3 dimension = vdb_ptr->dimension;
-        VkDeviceSize imageSize = dimension.x * dimension.y * dimension.z * 4;
+        glm::ivec3 dimension(voxels.GetDimension());
+        VkDeviceSize imageSize = static_cast<VkDeviceSize>(dimension.x) * dimension.y * dimension.z * 4;
 
-        // Create staging buffer
+        // Quantized and interleaved straight into the staging buffer
         VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-
-        VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-        BufferUtils::CreateBuffer(device, imageSize, stagingUsage, stagingProperties, stagingBuffer, stagingBufferMemory);
-
-        const std::vector<VDatAlt>& vdbData = vdb_ptr->mDataPoints;
-
-        for (uint32_t i = 0; i < static_cast<uint32_t>(dimension.z); ++i)
-        {
-            unsigned char* pixels = Image::GenerateVDBSlice(vdbData, i, dimension);
-            if (!pixels) {
-                std::cout << "Failed to load texture image" << i << std::endl;
-                throw std::runtime_error("Failed to load texture image");
-            }
+        unsigned char* stagingData = static_cast<unsigned char*>(batch.CreateStagingBuffer(imageSize, stagingBuffer));
+        voxels.PackRGBA8(stagingData);
 
-            void* data;
-            imageSize = dimension.x * dimension.y * 4;
-            vkMapMemory(device->GetVkDevice(), stagingBufferMemory, static_cast<uint64_t>(i) * imageSize, imageSize, 0, &data);
-            memcpy(data, pixels, static_cast<size_t>(imageSize));
-            vkUnmapMemory(device->GetVkDevice(), stagingBufferMemory);
-
-            free(pixels);
+        if (!cacheKey.empty()) {
+            const VolumeChannel channels[4] = {};
+            VolumeHeader header = VolumeFile::MakeHeader(dimension.x, dimension.y, dimension.z, format, 4, channels);
+            cache.Store(cacheKey, header, stagingData);
         }
 
         // Create Vulkan image
         Image::Create3D(device, dimension, format, tiling, VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage, properties, image, imageMemory);
 
         // Copy the staging buffer to the texture image
-        Image::TransitionLayout(device, commandPool, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        Image::CopyFromBuffer(device, commandPool, stagingBuffer, image, static_cast<uint32_t>(dimension.x), static_cast<uint32_t>(dimension.y), static_cast<uint32_t>(dimension.z)); // TODO: check
+        batch.TransitionLayout(image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        batch.CopyBufferToImage(stagingBuffer, image, static_cast<uint32_t>(dimension.x), static_cast<uint32_t>(dimension.y), static_cast<uint32_t>(dimension.z)); // TODO: check
 
         // Transition texture image for shader access
-        Image::TransitionLayout(device, commandPool, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
-
-        // No need for staging buffer anymore
-        vkDestroyBuffer(device->GetVkDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(device->GetVkDevice(), stagingBufferMemory, nullptr);
+        batch.TransitionLayout(image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
     }
     else
     {
         std::cout << "VDB not loaded" << std::endl;
     }
+    delete loader;
 }
 
-Texture* Image::CreateColorTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, VkFormat format) {
+Texture* Image::CreateColorTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, VkFormat format, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateColorTexture");
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     Image::Create(device,
         extent.width,
@@ -428,11 +421,10 @@ Texture* Image::CreateColorTexture(Device* device, VkCommandPool commandPool, Vk
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         texture->image,
-        texture->imageMemory);
+        texture->imageMemory,
+        true);
 
-    Image::TransitionLayout(device,
-        commandPool,
-        texture->image,
+    upload.TransitionLayout(texture->image,
         format,
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -443,10 +435,15 @@ Texture* Image::CreateColorTexture(Device* device, VkCommandPool commandPool, Vk
         VK_IMAGE_ASPECT_COLOR_BIT,
         VK_IMAGE_VIEW_TYPE_2D);
 
+    localBatch.Submit();
     return texture;
 }
 
-Texture* Image::CreateDepthTexture(Device* device, VkCommandPool graphicsCommandPool, VkExtent2D extent) {
+Texture* Image::CreateDepthTexture(Device* device, VkCommandPool graphicsCommandPool, VkExtent2D extent, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateDepthTexture");
+    UploadBatch localBatch(device, graphicsCommandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat depthFormat = device->GetInstance()->GetSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
     // CREATE DEPTH IMAGE
@@ -458,18 +455,24 @@ Texture* Image::CreateDepthTexture(Device* device, VkCommandPool graphicsCommand
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         texture->image,
-        texture->imageMemory
+        texture->imageMemory,
+        true
     );
 
     // Transition the image for use as depth-stencil
-    Image::TransitionLayout(device, graphicsCommandPool, texture->image, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    upload.TransitionLayout(texture->image, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
     texture->imageView = Image::CreateView(device, texture->image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D);
 
+    localBatch.Submit();
     return texture;
 }
 
-Texture* Image::CreateStorageTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent) {
+Texture* Image::CreateStorageTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateStorageTexture");
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
     int texWidth = extent.width, texHeight = extent.height, texChannels = 4;
@@ -483,17 +486,24 @@ Texture* Image::CreateStorageTexture(Device* device, VkCommandPool commandPool,
         VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, 
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
         texture->image, 
-        texture->imageMemory);
+        texture->imageMemory,
+        true);
 
-    Image::TransitionLayout(device, commandPool, texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // TODO: check new layout
+    // Owned by the graphics family after this, the compute passes discard the contents before writing it
+    upload.TransitionLayout(texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // TODO: check new layout
 
     texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D);
     texture->sampler = Image::CreateSampler(device);
 
+    localBatch.Submit();
     return texture;
 }
 
-Texture* Image::CreateStorageTextureHalfRes(Device* device, VkCommandPool commandPool, VkExtent2D extent) {
+Texture* Image::CreateStorageTextureHalfRes(Device* device, VkCommandPool commandPool, VkExtent2D extent, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateStorageTextureHalfRes");
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
     int texWidth = extent.width / 2;
@@ -511,15 +521,20 @@ Texture* Image::CreateStorageTextureHalfRes(Device* device, VkCommandPool comman
         texture->image,
         texture->imageMemory);
 
-    Image::TransitionLayout(device, commandPool, texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // TODO: check new layout
+    upload.TransitionLayout(texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // TODO: check new layout
 
     texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D);
     texture->sampler = Image::CreateSampler(device);
 
+    localBatch.Submit();
     return texture;
 }
 
-Texture* Image::CreateStorageTexture3D(Device* device, VkCommandPool commandPool, glm::ivec3 dimension) {
+Texture* Image::CreateStorageTexture3D(Device* device, VkCommandPool commandPool, glm::ivec3 dimension, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateStorageTexture3D");
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
 
@@ -532,20 +547,25 @@ Texture* Image::CreateStorageTexture3D(Device* device, VkCommandPool commandPool
         texture->image,
         texture->imageMemory);
 
-    Image::TransitionLayout(device, commandPool, texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // TODO: check new layout
+    upload.TransitionLayout(texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL); // TODO: check new layout
 
     texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
     texture->sampler = Image::CreateSampler(device);
 
+    localBatch.Submit();
     return texture;
 }
 
-Texture* Image::CreateTextureFromFile(Device* device, VkCommandPool commandPool, const char* path) {
+Texture* Image::CreateTextureFromFile(Device* device, VkCommandPool commandPool, const char* path, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateTextureFromFile", path);
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
 
     Image::FromFile(device, 
-        commandPool, 
+        upload, 
         path, 
         imageFormat,
         VK_IMAGE_TILING_OPTIMAL, 
@@ -557,16 +577,22 @@ Texture* Image::CreateTextureFromFile(Device* device, VkCommandPool commandPool,
 
     texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D);
     texture->sampler = Image::CreateSampler(device);
+
+    localBatch.Submit();
     return texture;
 }
 
 // path only contain the general file name, not the extension
-Texture* Image::CreateTexture3DFromFiles(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension) {
+Texture* Image::CreateTexture3DFromFiles(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateTexture3DFromFiles", path);
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
 
     Image::FromFiles(device, 
-        commandPool, 
+        upload, 
         path, 
         dimension, 
         imageFormat, 
@@ -580,16 +606,102 @@ Texture* Image::CreateTexture3DFromFiles(Device* device, VkCommandPool commandPo
     texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
     texture->sampler = Image::CreateSampler(device);
 
+    localBatch.Submit();
+    return texture;
+}
+
+Texture* Image::CreateTexture3DFromVolumeFile(Device* device, VkCommandPool commandPool, const char* path, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateTexture3DFromVolumeFile", path);
+    VolumeFile volume;
+    if (!volume.Open(path)) {
+        throw std::runtime_error(std::string("Failed to open volume file ") + path);
+    }
+
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
+    Texture* texture = new Texture();
+
+    Image::FromVolumeFile(device,
+        upload,
+        volume,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        texture->image,
+        texture->imageMemory);
+
+    texture->imageView = Image::CreateView(device, texture->image, volume.GetFormat(), VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
+    texture->sampler = Image::CreateSampler(device);
+
+    localBatch.Submit();
     return texture;
 }
 
-Texture* Image::CreateTextureFromVDBFile(Device* device, VkCommandPool commandPool, const char* path)
+// Prefers the packed "<path>.pvol" written by volume_pack, falls back to decoding the .tga slices
+Texture* Image::CreateTexture3D(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreateTexture3D", path);
+    std::string packedPath = VolumeFile::GetPackedPath(path);
+
+    VolumeFile volume;
+    if (volume.Open(packedPath)) {
+        const VolumeHeader& header = volume.GetHeader();
+        if (glm::ivec3(header.width, header.height, header.depth) == dimension) {
+            volume.Close();
+            return Image::CreateTexture3DFromVolumeFile(device, commandPool, packedPath.c_str(), batch);
+        }
+
+        std::cout << "Ignoring " << packedPath << ", dimensions do not match" << std::endl;
+    }
+
+    return Image::CreateTexture3DFromFiles(device, commandPool, path, dimension, batch);
+}
+
+// Empty (all zero) 1x1x1 volume, bound while the real data is still streaming in
+Texture* Image::CreatePlaceholderTexture3D(Device* device, VkCommandPool commandPool, UploadBatch* batch) {
+    TRACE_ZONE("Image::CreatePlaceholderTexture3D");
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
+    Texture* texture = new Texture();
+    VkFormat imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+    VkBuffer stagingBuffer;
+    void* data = upload.CreateStagingBuffer(4, stagingBuffer);
+    memset(data, 0, 4);
+
+    Image::Create3D(device,
+        glm::ivec3(1, 1, 1),
+        imageFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        texture->image,
+        texture->imageMemory);
+
+    upload.TransitionLayout(texture->image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    upload.CopyBufferToImage(stagingBuffer, texture->image, 1, 1, 1);
+    upload.TransitionLayout(texture->image, imageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
+    texture->sampler = Image::CreateSampler(device);
+
+    localBatch.Submit();
+    return texture;
+}
+
+Texture* Image::CreateTextureFromVDBFile(Device* device, VkCommandPool commandPool, const char* path, UploadBatch* batch)
 {
+    TRACE_ZONE("Image::CreateTextureFromVDBFile", path);
+    UploadBatch localBatch(device, commandPool);
+    UploadBatch& upload = batch ? *batch : localBatch;
+
     Texture* texture = new Texture();
     VkFormat imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
 
     Image::FromVDBFile(device,
-        commandPool,
+        upload,
         path,
         imageFormat,
         VK_IMAGE_TILING_OPTIMAL,
@@ -602,26 +714,6 @@ Texture* Image::CreateTextureFromVDBFile(Device* device, VkCommandPool commandPo
     texture->imageView = Image::CreateView(device, texture->image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
     texture->sampler = Image::CreateSampler(device);
 
+    localBatch.Submit();
     return texture;
 }
-
-unsigned char* Image::GenerateVDBSlice(const std::vector<VDatAlt>& data, unsigned int depth, glm::vec3 dimension)
-{
-    unsigned char* result = new unsigned char[dimension.x * dimension.y * 4];
-    int idx = 0;
-    int xmultiplier = dimension.y * dimension.z;
-    int ymultiplier = dimension.z;
-    for (int i = 0; i < dimension.x; i++) 
-    {
-        for (int j = 0; j < dimension.y; j++) 
-        {
-            const VDatAlt& vdat = data[i * xmultiplier + j * ymultiplier + depth];
-            result[idx] = vdat.dimensional_profile;
-            result[idx + 1] = vdat.detail_type;
-            result[idx + 2] = vdat.density_scale;
-            result[idx + 3] = vdat.sdf;
-            idx = idx + 4;
-        }
-    }
-    return result;
-}
@@ -5,44 +5,65 @@
 #include "Device.h"
 #include "vdb/VDBLoader.h"
 
+class UploadBatch;
+class VolumeFile;
+
 struct Texture {
 	VkImage image;
-    VkDeviceMemory imageMemory;
+    Allocation imageMemory;
 	VkImageView imageView;
 	VkSampler sampler; // if exists
 
+    // Streamed volumes only: texel extent and the world space box they cover (empty if the file has none)
+    glm::ivec3 dimension = glm::ivec3(0);
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
     Texture() = default;
 
-    void CleanUp(VkDevice logicalDevice) {
-		vkDestroyImageView(logicalDevice, imageView, nullptr);
-		vkDestroyImage(logicalDevice, image, nullptr);
-		vkFreeMemory(logicalDevice, imageMemory, nullptr);
+    void CleanUp(Device* device) {
+		vkDestroyImageView(device->GetVkDevice(), imageView, nullptr);
+		vkDestroyImage(device->GetVkDevice(), image, nullptr);
+		device->GetAllocator()->Free(imageMemory);
 	}
 };
 
 namespace Image {
-    void Create(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-    void Create3D(Device* device, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    // Images are shared by the graphics and compute families unless exclusive, an exclusive image
+    // starts out owned by the family that first uses it and has to be transferred explicitly
+    void Create(Device* device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory, bool exclusive = false);
+    void Create3D(Device* device, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory);
+    void RecordTransitionLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
     void TransitionLayout(Device* device, VkCommandPool commandPool, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
     VkImageView CreateView(Device* device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageViewType viewType);
     VkSampler CreateSampler(Device* device);
+    void RecordCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth);
     void CopyFromBuffer(Device* device, VkCommandPool commandPool, VkBuffer buffer, VkImage& image, uint32_t width, uint32_t height, uint32_t depth);
-    void FromFile(Device* device, VkCommandPool commandPool, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-    void FromFiles(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory); // to constuct 3D
 
-    void FromVDBFile(Device* device, VkCommandPool commandPool, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    // Loaders record their transitions and copies into batch, nothing is on the GPU until batch.Submit()
+    void FromFile(Device* device, UploadBatch& batch, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory);
+    // Decodes the "<path>(i).tga" slices of a RGBA8 volume in parallel into data (dimension.x * dimension.y * dimension.z * 4 bytes)
+    void DecodeSlices(const char* path, glm::ivec3 dimension, unsigned char* data);
+    void FromFiles(Device* device, UploadBatch& batch, const char* path, glm::ivec3 dimension, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory); // to constuct 3D
+    void FromVolumeFile(Device* device, UploadBatch& batch, const VolumeFile& volume, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory);
+
+    void FromVDBFile(Device* device, UploadBatch& batch, const char* path, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory);
 
     // --- Specific Texture Creation ---
-    Texture* CreateColorTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, VkFormat format);
-    Texture* CreateDepthTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent);
-    Texture* CreateStorageTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent);
-    Texture* CreateStorageTextureHalfRes(Device* device, VkCommandPool commandPool, VkExtent2D extent);
-    Texture* CreateStorageTexture3D(Device* device, VkCommandPool commandPool, glm::ivec3 dimension);
-
-    Texture* CreateTextureFromFile(Device* device, VkCommandPool commandPool, const char* path);
-    Texture* CreateTexture3DFromFiles(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension);
-
-    Texture* CreateTextureFromVDBFile(Device* device, VkCommandPool commandPool, const char* path);
-    
-    unsigned char* GenerateVDBSlice(const std::vector<VDatAlt>& data, unsigned int depth, glm::vec3 dimension);
+    // With a batch the upload is deferred to batch->Submit(), otherwise the texture is ready on return
+    Texture* CreateColorTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, VkFormat format, UploadBatch* batch = nullptr);
+    Texture* CreateDepthTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, UploadBatch* batch = nullptr);
+    // Exclusive, the renderer hands it from the compute to the graphics family every frame
+    Texture* CreateStorageTexture(Device* device, VkCommandPool commandPool, VkExtent2D extent, UploadBatch* batch = nullptr);
+    Texture* CreateStorageTextureHalfRes(Device* device, VkCommandPool commandPool, VkExtent2D extent, UploadBatch* batch = nullptr);
+    Texture* CreateStorageTexture3D(Device* device, VkCommandPool commandPool, glm::ivec3 dimension, UploadBatch* batch = nullptr);
+
+    Texture* CreateTextureFromFile(Device* device, VkCommandPool commandPool, const char* path, UploadBatch* batch = nullptr);
+    Texture* CreateTexture3DFromFiles(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension, UploadBatch* batch = nullptr);
+    Texture* CreateTexture3DFromVolumeFile(Device* device, VkCommandPool commandPool, const char* path, UploadBatch* batch = nullptr);
+    Texture* CreateTexture3D(Device* device, VkCommandPool commandPool, const char* path, glm::ivec3 dimension, UploadBatch* batch = nullptr); // packed volume or .tga slices
+
+    Texture* CreatePlaceholderTexture3D(Device* device, VkCommandPool commandPool, UploadBatch* batch = nullptr);
+
+    Texture* CreateTextureFromVDBFile(Device* device, VkCommandPool commandPool, const char* path, UploadBatch* batch = nullptr);
 }
@@ -1,7 +1,9 @@
+#include <iostream>
 #include <stdexcept>
 #include <set>
 #include <vector>
 #include "Instance.h"
+#include "Trace.h"
 
 #ifdef NDEBUG
 const bool ENABLE_VALIDATION = false;
@@ -46,6 +48,8 @@ namespace {
 }
 
 Instance::Instance(const char* applicationName, unsigned int additionalExtensionCount, const char** additionalExtensions) {
+    TRACE_ZONE("Instance::Instance");
+
     // --- Specify details about our application ---
     VkApplicationInfo appInfo = {};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -53,7 +57,8 @@ Instance::Instance(const char* applicationName, unsigned int additionalExtension
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Timeline semaphores order the compute and graphics passes, they are core in 1.2
+    appInfo.apiVersion = VK_API_VERSION_1_2;
     
     // --- Create Vulkan instance ---
     VkInstanceCreateInfo createInfo = {};
@@ -108,6 +113,10 @@ const std::vector<VkPresentModeKHR>& Instance::GetPresentModes() const {
     return presentModes;
 }
 
+const VkPhysicalDeviceMemoryProperties& Instance::GetMemoryProperties() const {
+    return deviceMemoryProperties;
+}
+
 uint32_t Instance::GetMemoryTypeIndex(uint32_t typeBits, VkMemoryPropertyFlags properties) const {
     // Iterate over all memory types available for the device used in this example
     for (uint32_t i = 0; i < deviceMemoryProperties.memoryTypeCount; i++) {
@@ -183,40 +192,53 @@ namespace {
         indices.fill(-1);
         VkQueueFlags supportedQueues = 0;
         bool needsPresent = requiredQueues[QueueFlags::Present];
-        bool presentSupported = false;
 
-        int i = 0;
-        for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueCount > 0) {
-                supportedQueues |= queueFamily.queueFlags;
+        // Look at every family instead of stopping at the first that covers everything, a compute family
+        // without graphics runs alongside the graphics queue
+        int dedicatedCompute = -1;
+        for (int i = 0; i < static_cast<int>(queueFamilies.size()); ++i) {
+            const VkQueueFamilyProperties& queueFamily = queueFamilies[i];
+            if (queueFamily.queueCount == 0) {
+                continue;
             }
+            supportedQueues |= queueFamily.queueFlags;
 
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            bool graphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            bool compute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+            if (graphics && indices[QueueFlags::Graphics] < 0) {
                 indices[QueueFlags::Graphics] = i;
             }
-
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+            if (compute && indices[QueueFlags::Compute] < 0) {
                 indices[QueueFlags::Compute] = i;
             }
-
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) {
-                indices[QueueFlags::Transfer] = i;
+            if (compute && !graphics && dedicatedCompute < 0) {
+                dedicatedCompute = i;
             }
 
             if (needsPresent) {
                 VkBool32 presentSupport = false;
                 vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-                if (queueFamily.queueCount > 0 && presentSupport) {
-                    presentSupported = true;
+                // Presenting from the graphics family saves sharing the swapchain images
+                if (presentSupport && (indices[QueueFlags::Present] < 0 || i == indices[QueueFlags::Graphics])) {
                     indices[QueueFlags::Present] = i;
                 }
             }
+        }
 
-            if ((requiredVulkanQueues & supportedQueues) == requiredVulkanQueues && (!needsPresent || presentSupported)) {
-                break;
-            }
+        if (dedicatedCompute >= 0) {
+            indices[QueueFlags::Compute] = dedicatedCompute;
+        }
+        // Uploads share the graphics family, a transfer-only family would need ownership transfers of every
+        // streamed image and cannot make the shader stage layout transitions itself. Graphics and compute
+        // families support transfers whether or not they report the bit.
+        if (indices[QueueFlags::Graphics] >= 0) {
+            indices[QueueFlags::Transfer] = indices[QueueFlags::Graphics];
+        } else {
+            indices[QueueFlags::Transfer] = indices[QueueFlags::Compute];
+        }
 
-            i++;
+        if ((requiredVulkanQueues & supportedQueues) != requiredVulkanQueues) {
+            indices.fill(-1);
         }
 
         return indices;
@@ -238,9 +260,27 @@ namespace {
 
         return requiredExtensionSet.empty();
     }
+
+    bool checkDeviceTimelineSemaphoreSupport(VkPhysicalDevice device) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &timelineFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+        return timelineFeatures.timelineSemaphore == VK_TRUE;
+    }
 }
 
 void Instance::PickPhysicalDevice(std::vector<const char*> deviceExtensions, QueueFlagBits requiredQueues, VkSurfaceKHR surface) {
+    TRACE_ZONE("Instance::PickPhysicalDevice");
+
     // List the graphics cards on the machine
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -287,6 +327,7 @@ void Instance::PickPhysicalDevice(std::vector<const char*> deviceExtensions, Que
 
         if (queueSupport &&
             checkDeviceExtensionSupport(device, deviceExtensions) &&
+            checkDeviceTimelineSemaphoreSupport(device) &&
             (!requiredQueues[QueueFlags::Present] || (!surfaceFormats.empty() && ! presentModes.empty()))
         ) {
             physicalDevice = device;
@@ -304,6 +345,8 @@ void Instance::PickPhysicalDevice(std::vector<const char*> deviceExtensions, Que
 }
 
 Device* Instance::CreateDevice(QueueFlagBits requiredQueues, VkPhysicalDeviceFeatures deviceFeatures) {
+    TRACE_ZONE("Instance::CreateDevice");
+
     std::set<int> uniqueQueueFamilies;
     bool queueSupport = true;
     for (unsigned int i = 0; i < requiredQueues.size(); ++i) {
@@ -337,6 +380,11 @@ Device* Instance::CreateDevice(QueueFlagBits requiredQueues, VkPhysicalDeviceFea
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+    createInfo.pNext = &timelineFeatures;
+
     // Enable device-specific extensions and validation layers
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -354,6 +402,10 @@ Device* Instance::CreateDevice(QueueFlagBits requiredQueues, VkPhysicalDeviceFea
         throw std::runtime_error("Failed to create logical device");
     }
 
+    std::cout << "Queue families: graphics " << queueFamilyIndices[QueueFlags::Graphics]
+        << ", compute " << queueFamilyIndices[QueueFlags::Compute]
+        << ", transfer " << queueFamilyIndices[QueueFlags::Transfer] << std::endl;
+
     Device::Queues queues;
     for (unsigned int i = 0; i < requiredQueues.size(); ++i) {
         if (requiredQueues[i]) {
@@ -361,7 +413,7 @@ Device* Instance::CreateDevice(QueueFlagBits requiredQueues, VkPhysicalDeviceFea
         }
     }
 
-    return new Device(this, physicalDevice, vkDevice, queues);
+    return new Device(this, physicalDevice, vkDevice, queues, deviceFeatures);
 }
 
 Instance::~Instance() {
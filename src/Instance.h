@@ -21,6 +21,7 @@ public:
     const std::vector<VkSurfaceFormatKHR>& GetSurfaceFormats() const;
     const std::vector<VkPresentModeKHR>& GetPresentModes() const;
     
+    const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const;
     uint32_t GetMemoryTypeIndex(uint32_t types, VkMemoryPropertyFlags properties) const;
     VkFormat GetSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
 
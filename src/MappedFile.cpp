@@ -0,0 +1,125 @@
+#include "MappedFile.h"
+#include "Trace.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    Trace::AddBytesRead(size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+    }
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    // Files are read front to back once
+    madvise(view, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileStat.st_size);
+    Trace::AddBytesRead(size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+}
+
+#endif
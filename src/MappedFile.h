@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false if the file does not exist or cannot be mapped
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return data != nullptr; }
+    const uint8_t* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
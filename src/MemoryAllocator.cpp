@@ -0,0 +1,276 @@
+#include "MemoryAllocator.h"
+#include "Device.h"
+#include "Instance.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+MemoryAllocator::MemoryAllocator(Device* device)
+  : device(device), memoryProperties(device->GetInstance()->GetMemoryProperties()) {}
+
+MemoryAllocator::~MemoryAllocator() {
+    if (allocationCount > 0) {
+        std::cout << "MemoryAllocator: " << allocationCount << " allocations still alive at shutdown" << std::endl;
+    }
+
+    for (Block& block : blocks) {
+        if (block.memory != VK_NULL_HANDLE) {
+            FreeDeviceMemory(block.memory, block.mappedData != nullptr);
+        }
+    }
+}
+
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Allocation allocation;
+    allocation.memoryType = device->GetInstance()->GetMemoryTypeIndex(requirements.memoryTypeBits, properties);
+    allocation.size = requirements.size;
+
+    VkDeviceSize blockSize = GetBlockSize(allocation.memoryType);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    // Large resources (volume textures, full screen targets on big displays) get their own memory
+    if (requirements.size > blockSize / 2) {
+        allocation.memory = AllocateDeviceMemory(requirements.size, allocation.memoryType, &allocation.mappedData);
+        ++dedicatedCount;
+        dedicatedBytes += requirements.size;
+        ++allocationCount;
+        ++totalAllocationCount;
+        return allocation;
+    }
+
+    int32_t blockIndex = -1;
+    VkDeviceSize offset = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        Block& block = blocks[i];
+        if (block.memory == VK_NULL_HANDLE || block.memoryType != allocation.memoryType || block.linear != linear) {
+            continue;
+        }
+        if (AllocateFromBlock(block, requirements.size, alignment, offset)) {
+            blockIndex = static_cast<int32_t>(i);
+            break;
+        }
+    }
+
+    if (blockIndex < 0) {
+        Block block;
+        block.memory = AllocateDeviceMemory(blockSize, allocation.memoryType, &block.mappedData);
+        block.size = blockSize;
+        block.memoryType = allocation.memoryType;
+        block.linear = linear;
+        block.freeRanges.push_back({ 0, blockSize });
+
+        // Reuse the slot of a released block so indices held by live allocations stay valid
+        auto slot = std::find_if(blocks.begin(), blocks.end(), [](const Block& b) { return b.memory == VK_NULL_HANDLE; });
+        if (slot != blocks.end()) {
+            *slot = std::move(block);
+            blockIndex = static_cast<int32_t>(slot - blocks.begin());
+        } else {
+            blocks.push_back(std::move(block));
+            blockIndex = static_cast<int32_t>(blocks.size() - 1);
+        }
+
+        AllocateFromBlock(blocks[blockIndex], requirements.size, alignment, offset);
+    }
+
+    Block& block = blocks[blockIndex];
+    block.used += requirements.size;
+    ++block.allocationCount;
+    ++allocationCount;
+    ++totalAllocationCount;
+
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.blockIndex = blockIndex;
+    if (block.mappedData) {
+        allocation.mappedData = static_cast<char*>(block.mappedData) + offset;
+    }
+    return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (allocation.blockIndex < 0) {
+        FreeDeviceMemory(allocation.memory, allocation.mappedData != nullptr);
+        --dedicatedCount;
+        dedicatedBytes -= allocation.size;
+    } else {
+        Block& block = blocks[allocation.blockIndex];
+
+        // Insert the range back in offset order and merge it with its neighbours
+        FreeRange range = { allocation.offset, allocation.size };
+        auto next = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), range,
+            [](const FreeRange& a, const FreeRange& b) { return a.offset < b.offset; });
+        auto it = block.freeRanges.insert(next, range);
+
+        if (it + 1 != block.freeRanges.end() && it->offset + it->size == (it + 1)->offset) {
+            it->size += (it + 1)->size;
+            block.freeRanges.erase(it + 1);
+        }
+        if (it != block.freeRanges.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+            (it - 1)->size += it->size;
+            block.freeRanges.erase(it);
+        }
+
+        block.used -= allocation.size;
+        if (--block.allocationCount == 0) {
+            ReleaseEmptyBlocks(block.memoryType, block.linear);
+        }
+    }
+
+    --allocationCount;
+    allocation = Allocation();
+}
+
+Allocation MemoryAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device->GetVkDevice(), buffer, &memRequirements);
+
+    Allocation allocation = Allocate(memRequirements, properties, true);
+    vkBindBufferMemory(device->GetVkDevice(), buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+Allocation MemoryAllocator::AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device->GetVkDevice(), image, &memRequirements);
+
+    Allocation allocation = Allocate(memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
+    vkBindImageMemory(device->GetVkDevice(), image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+MemoryStats MemoryAllocator::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    MemoryStats stats;
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize scatteredBytes = 0;
+    for (const Block& block : blocks) {
+        if (block.memory == VK_NULL_HANDLE) {
+            continue;
+        }
+        ++stats.blockCount;
+        stats.reservedBytes += block.size;
+        stats.usedBytes += block.used;
+        stats.freeRangeCount += static_cast<uint32_t>(block.freeRanges.size());
+
+        VkDeviceSize largest = 0;
+        for (const FreeRange& range : block.freeRanges) {
+            largest = std::max(largest, range.size);
+        }
+        stats.largestFreeRange = std::max(stats.largestFreeRange, largest);
+        freeBytes += block.size - block.used;
+        scatteredBytes += block.size - block.used - largest;
+    }
+    if (freeBytes > 0) {
+        stats.fragmentation = static_cast<float>(scatteredBytes) / static_cast<float>(freeBytes);
+    }
+
+    stats.dedicatedCount = dedicatedCount;
+    stats.deviceMemoryCount = stats.blockCount + dedicatedCount;
+    stats.allocationCount = allocationCount;
+    stats.totalAllocationCount = totalAllocationCount;
+    stats.reservedBytes += dedicatedBytes;
+    stats.usedBytes += dedicatedBytes;
+    return stats;
+}
+
+void MemoryAllocator::PrintStats() const {
+    MemoryStats stats = GetStats();
+    std::cout << "GPU memory: " << stats.allocationCount << " allocations in " << stats.deviceMemoryCount
+              << " device allocations (" << stats.blockCount << " blocks, " << stats.dedicatedCount << " dedicated), "
+              << (stats.usedBytes >> 20) << " / " << (stats.reservedBytes >> 20) << " MB used, "
+              << static_cast<int>(stats.fragmentation * 100.0f) << "% fragmented" << std::endl;
+}
+
+VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mappedData) {
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device->GetVkDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate device memory");
+    }
+
+    // Host visible memory stays mapped for its whole lifetime, it can only be mapped once
+    *mappedData = nullptr;
+    if (IsHostVisible(memoryType)) {
+        vkMapMemory(device->GetVkDevice(), memory, 0, VK_WHOLE_SIZE, 0, mappedData);
+    }
+    return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, bool mapped) {
+    if (mapped) {
+        vkUnmapMemory(device->GetVkDevice(), memory);
+    }
+    vkFreeMemory(device->GetVkDevice(), memory, nullptr);
+}
+
+bool MemoryAllocator::AllocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    for (size_t i = 0; i < block.freeRanges.size(); ++i) {
+        FreeRange& range = block.freeRanges[i];
+        VkDeviceSize alignedOffset = (range.offset + alignment - 1) / alignment * alignment;
+        VkDeviceSize padding = alignedOffset - range.offset;
+        if (padding + size > range.size) {
+            continue;
+        }
+
+        VkDeviceSize end = alignedOffset + size;
+        VkDeviceSize rangeEnd = range.offset + range.size;
+        if (padding > 0) {
+            // The alignment padding stays free, only the tail is split off
+            range.size = padding;
+            if (rangeEnd > end) {
+                block.freeRanges.insert(block.freeRanges.begin() + i + 1, { end, rangeEnd - end });
+            }
+        } else if (rangeEnd > end) {
+            range.offset = end;
+            range.size = rangeEnd - end;
+        } else {
+            block.freeRanges.erase(block.freeRanges.begin() + i);
+        }
+
+        offset = alignedOffset;
+        return true;
+    }
+    return false;
+}
+
+void MemoryAllocator::ReleaseEmptyBlocks(uint32_t memoryType, bool linear) {
+    // Keep one empty block per pool around so a resize does not go back to the driver
+    bool keptOne = false;
+    for (Block& block : blocks) {
+        if (block.memory == VK_NULL_HANDLE || block.memoryType != memoryType || block.linear != linear || block.allocationCount > 0) {
+            continue;
+        }
+        if (!keptOne) {
+            keptOne = true;
+            continue;
+        }
+        FreeDeviceMemory(block.memory, block.mappedData != nullptr);
+        block = Block();
+    }
+}
+
+bool MemoryAllocator::IsHostVisible(uint32_t memoryType) const {
+    return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryType) const {
+    VkDeviceSize blockSize = IsHostVisible(memoryType) ? HOST_VISIBLE_BLOCK_SIZE : DEVICE_LOCAL_BLOCK_SIZE;
+
+    // Small heaps (e.g. 256 MB BAR memory) would be eaten up by a couple of blocks
+    uint32_t heapIndex = memoryProperties.memoryTypes[memoryType].heapIndex;
+    return std::min(blockSize, memoryProperties.memoryHeaps[heapIndex].size / 8);
+}
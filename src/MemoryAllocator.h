@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class Device;
+
+// A range of device memory handed out by MemoryAllocator, bind with (memory, offset)
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mappedData = nullptr; // persistently mapped when the memory is host visible
+
+    uint32_t memoryType = 0;
+    int32_t blockIndex = -1; // -1 for dedicated allocations
+};
+
+struct MemoryStats {
+    uint32_t deviceMemoryCount = 0; // live vkAllocateMemory allocations
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0; // live Allocations, including dedicated ones
+    uint64_t totalAllocationCount = 0; // Allocate calls since startup, steady state frames should not add any
+    VkDeviceSize reservedBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    uint32_t freeRangeCount = 0;
+    VkDeviceSize largestFreeRange = 0;
+
+    // Share of the free block memory that lies outside the largest free range of its block.
+    // 0 when every block has one contiguous free range, towards 1 as free space gets scattered.
+    float fragmentation = 0.0f;
+};
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks (one pool per memory type,
+// separate pools for linear and optimal resources so bufferImageGranularity never applies).
+// Free ranges are kept sorted by offset, allocation is first fit and neighbours are merged on free.
+// Requests larger than half a block get their own dedicated allocation.
+class MemoryAllocator {
+public:
+    static constexpr VkDeviceSize DEVICE_LOCAL_BLOCK_SIZE = 256ull << 20;
+    static constexpr VkDeviceSize HOST_VISIBLE_BLOCK_SIZE = 64ull << 20;
+
+    explicit MemoryAllocator(Device* device);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    // linear is true for buffers and linear tiled images
+    Allocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+    void Free(Allocation& allocation);
+
+    Allocation AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+    Allocation AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties);
+
+    MemoryStats GetStats() const;
+    void PrintStats() const;
+
+private:
+    struct FreeRange {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize used = 0;
+        void* mappedData = nullptr;
+        uint32_t memoryType = 0;
+        bool linear = false;
+        uint32_t allocationCount = 0;
+        std::vector<FreeRange> freeRanges;
+    };
+
+    VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mappedData);
+    void FreeDeviceMemory(VkDeviceMemory memory, bool mapped);
+    bool AllocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    void ReleaseEmptyBlocks(uint32_t memoryType, bool linear);
+    bool IsHostVisible(uint32_t memoryType) const;
+    VkDeviceSize GetBlockSize(uint32_t memoryType) const;
+
+    Device* device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+
+    std::vector<Block> blocks; // freed blocks are left empty (memory == VK_NULL_HANDLE) so indices stay stable
+    uint32_t dedicatedCount = 0;
+    VkDeviceSize dedicatedBytes = 0;
+    uint32_t allocationCount = 0;
+    uint64_t totalAllocationCount = 0;
+
+    mutable std::mutex mutex;
+};
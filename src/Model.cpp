@@ -50,17 +50,14 @@ Model::Model(Device* device, VkCommandPool commandPool, const std::vector<Vertex
 
 Model::~Model() {
     if (indices.size() > 0) {
-        vkDestroyBuffer(device->GetVkDevice(), indexBuffer, nullptr);
-        vkFreeMemory(device->GetVkDevice(), indexBufferMemory, nullptr);
+        BufferUtils::DestroyBuffer(device, indexBuffer, indexBufferMemory);
     }
 
     if (vertices.size() > 0) {
-        vkDestroyBuffer(device->GetVkDevice(), vertexBuffer, nullptr);
-        vkFreeMemory(device->GetVkDevice(), vertexBufferMemory, nullptr);
+        BufferUtils::DestroyBuffer(device, vertexBuffer, vertexBufferMemory);
     }
 
-    vkDestroyBuffer(device->GetVkDevice(), modelBuffer, nullptr);
-    vkFreeMemory(device->GetVkDevice(), modelBufferMemory, nullptr);
+    BufferUtils::DestroyBuffer(device, modelBuffer, modelBufferMemory);
 }
 
 const std::vector<Vertex>& Model::getVertices() const {
@@ -21,14 +21,14 @@ protected:
 
     std::vector<Vertex> vertices;
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    Allocation vertexBufferMemory;
 
     std::vector<uint32_t> indices;
     VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    Allocation indexBufferMemory;
 
     VkBuffer modelBuffer;
-    VkDeviceMemory modelBufferMemory;
+    Allocation modelBufferMemory;
 
     ModelBufferObject modelBufferObject;
 
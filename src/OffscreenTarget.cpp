@@ -0,0 +1,156 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "OffscreenTarget.h"
+#include "BufferUtils.h"
+#include "Image.h"
+#include "Trace.h"
+
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+OffscreenTarget::OffscreenTarget(Device* device, VkExtent2D extent, const std::string& capturePrefix)
+  : device(device), extent(extent), capturePrefix(capturePrefix) {
+    TRACE_ZONE("OffscreenTarget::OffscreenTarget");
+
+    // Only the graphics queue touches it, the render pass takes it from UNDEFINED every frame
+    Image::Create(device,
+        extent.width,
+        extent.height,
+        format,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        image,
+        imageMemory,
+        true);
+
+    if (capturePrefix.empty()) {
+        return;
+    }
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = device->GetQueueIndex(QueueFlags::Graphics);
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(device->GetVkDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(device->GetVkDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffers");
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device->GetVkDevice(), &fenceInfo, nullptr, &captureFence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fence");
+    }
+
+    BufferUtils::CreateBuffer(device,
+        static_cast<VkDeviceSize>(extent.width) * extent.height * 4,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        readbackBuffer,
+        readbackMemory);
+}
+
+bool OffscreenTarget::Acquire(VkSemaphore imageAvailable) {
+    // The image is free once the previous frame's render pass is done, which the graphics queue orders anyway
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &imageAvailable;
+    if (vkQueueSubmit(device->GetQueue(QueueFlags::Graphics), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to acquire offscreen image");
+    }
+    return true;
+}
+
+bool OffscreenTarget::Present(VkSemaphore renderFinished) {
+    if (!capturePrefix.empty()) {
+        Capture(renderFinished);
+    } else {
+        // Nothing reads the image, but the binary semaphore has to be waited on before it is signaled again
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &renderFinished;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        if (vkQueueSubmit(device->GetQueue(QueueFlags::Graphics), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to present offscreen image");
+        }
+    }
+    ++presentedCount;
+    return true;
+}
+
+void OffscreenTarget::Capture(VkSemaphore renderFinished) {
+    TRACE_ZONE("OffscreenTarget::Capture");
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffer");
+    }
+
+    // The render pass left the image in GetFinalLayout()
+    VkBufferImageCopy region = {};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record command buffer");
+    }
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &renderFinished;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    if (vkQueueSubmit(device->GetQueue(QueueFlags::Graphics), 1, &submitInfo, captureFence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit capture command buffer");
+    }
+    vkWaitForFences(device->GetVkDevice(), 1, &captureFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    vkResetFences(device->GetVkDevice(), 1, &captureFence);
+
+    // BGRA to RGB
+    const unsigned char* texels = static_cast<const unsigned char*>(readbackMemory.mappedData);
+    std::vector<unsigned char> pixels(static_cast<size_t>(extent.width) * extent.height * 3);
+    for (size_t i = 0; i < static_cast<size_t>(extent.width) * extent.height; ++i) {
+        pixels[i * 3 + 0] = texels[i * 4 + 2];
+        pixels[i * 3 + 1] = texels[i * 4 + 1];
+        pixels[i * 3 + 2] = texels[i * 4 + 0];
+    }
+
+    char number[16];
+    snprintf(number, sizeof(number), "%04u", presentedCount);
+    std::string path = capturePrefix + number + ".png";
+    if (!stbi_write_png(path.c_str(), extent.width, extent.height, 3, pixels.data(), extent.width * 3)) {
+        std::cout << "Failed to write " << path << std::endl;
+    }
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    if (readbackBuffer != VK_NULL_HANDLE) {
+        BufferUtils::DestroyBuffer(device, readbackBuffer, readbackMemory);
+        vkDestroyFence(device->GetVkDevice(), captureFence, nullptr);
+        vkDestroyCommandPool(device->GetVkDevice(), commandPool, nullptr);
+    }
+    vkDestroyImage(device->GetVkDevice(), image, nullptr);
+    device->GetAllocator()->Free(imageMemory);
+}
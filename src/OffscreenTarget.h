@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include "Device.h"
+#include "RenderTarget.h"
+
+// A single color image standing in for the swapchain of headless runs, which have neither a window nor
+// a queue that can present. Acquire and Present only signal and wait on the frame's semaphores.
+//
+// With a capture prefix every presented frame is copied back and written to "<prefix>0000.png", "<prefix>0001.png", ...
+// That waits for the frame on the CPU, without one nothing is read back and the GPU runs ahead as usual.
+class OffscreenTarget : public RenderTarget {
+public:
+    OffscreenTarget(Device* device, VkExtent2D extent, const std::string& capturePrefix = std::string());
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    VkFormat GetVkImageFormat() const override { return format; }
+    VkExtent2D GetVkExtent() const override { return extent; }
+    uint32_t GetIndex() const override { return 0; }
+    uint32_t GetCount() const override { return 1; }
+    VkImage GetVkImage(uint32_t index) const override { return image; }
+    VkImageLayout GetFinalLayout() const override { return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; }
+
+    bool Acquire(VkSemaphore imageAvailable) override;
+    bool Present(VkSemaphore renderFinished) override;
+
+    uint32_t GetPresentedCount() const { return presentedCount; }
+
+private:
+    void Capture(VkSemaphore renderFinished);
+
+    Device* device;
+    VkExtent2D extent;
+    // Same as the swapchain format the renderer prefers, so headless frames match windowed ones
+    VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
+    VkImage image;
+    Allocation imageMemory;
+
+    std::string capturePrefix;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence captureFence = VK_NULL_HANDLE;
+    VkBuffer readbackBuffer = VK_NULL_HANDLE;
+    Allocation readbackMemory;
+
+    uint32_t presentedCount = 0;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// The images the renderer draws its final pass into, a SwapChain or an OffscreenTarget for headless runs
+class RenderTarget {
+public:
+    virtual ~RenderTarget() = default;
+
+    virtual VkFormat GetVkImageFormat() const = 0;
+    virtual VkExtent2D GetVkExtent() const = 0;
+    // Image the current frame renders into, set by Acquire
+    virtual uint32_t GetIndex() const = 0;
+    virtual uint32_t GetCount() const = 0;
+    virtual VkImage GetVkImage(uint32_t index) const = 0;
+    // Layout the render pass leaves the images in
+    virtual VkImageLayout GetFinalLayout() const = 0;
+
+    // The semaphores belong to the caller's frame in flight, Acquire signals imageAvailable and Present waits on renderFinished.
+    // Both return false if the target changed size and the frame resources have to be recreated.
+    virtual bool Acquire(VkSemaphore imageAvailable) = 0;
+    virtual bool Present(VkSemaphore renderFinished) = 0;
+};
@@ -3,49 +3,67 @@
 #include "ShaderModule.h"
 #include "Vertex.h"
 #include "Camera.h"
+#include "DerivedDataCache.h"
+#include "UploadBatch.h"
+#include "Trace.h"
+#include "VolumeLayout.h"
 
+#include "BufferUtils.h"
 #include "Descriptor.h"
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <iostream>
+#include <limits>
 
 #define USE_UI 1
 
 static constexpr unsigned int WORKGROUP_SIZE = 32;
+// Room for one 512x512x64 RGBA8 modeling volume, inactive cloud types are evicted beyond that
+static constexpr VkDeviceSize MODELING_DATA_BUDGET = 64ull << 20;
 
-Renderer::Renderer(GLFWwindow* window, Device* device, SwapChain* swapChain, Scene* scene, Camera* camera)
+Renderer::Renderer(GLFWwindow* window, Device* device, RenderTarget* renderTarget, Scene* scene, Camera* camera, uint32_t framesInFlight)
   : device(device),
     logicalDevice(device->GetVkDevice()),
-    swapChain(swapChain),
+    renderTarget(renderTarget),
     scene(scene),
     camera(camera),
+    frames(framesInFlight),
     window(window) {
+    TRACE_ZONE("Renderer::Renderer");
 
     CreateCommandPools();
     CreateRenderPass();
+    profiler = new GpuProfiler(device, framesInFlight);
 
-//#if USE_UI
-    CreateUI();
-//#endif
+    if (HasUI()) {
+        CreateUI();
+    }
 
+    CreateStaticResources();
     CreateFrameResources();
     CreateModels();
+    CreateFrameSlots();
     CreateDescriptors();
     CreatePipelines();
 
-    commandBuffers.resize(swapChain->GetCount());
-    //RecordCommandBuffers();
+    RecordPostCommandBuffers();
     RecordComputeCommandBuffer();
 }
 
 void Renderer::UpdateUIBuffer() {
-    memcpy(uiControlBuffer.mappedData, &uiControlBufferObject, sizeof(UIControlBufferObject));
+    memcpy(frames[frameIndex].uiControlBuffer.mappedData, &uiControlBufferObject, sizeof(UIControlBufferObject));
 }
 
 void Renderer::CreateCommandPools() {
+    TRACE_ZONE("Renderer::CreateCommandPools");
+
     VkCommandPoolCreateInfo graphicsPoolInfo = {};
     graphicsPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     graphicsPoolInfo.queueFamilyIndex = device->GetInstance()->GetQueueFamilyIndices()[QueueFlags::Graphics];
-    graphicsPoolInfo.flags = 0;
+    // Frame slot buffers are rerecorded in place instead of reallocated
+    graphicsPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if (vkCreateCommandPool(logicalDevice, &graphicsPoolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create command pool");
@@ -54,7 +72,7 @@ void Renderer::CreateCommandPools() {
     VkCommandPoolCreateInfo computePoolInfo = {};
     computePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     computePoolInfo.queueFamilyIndex = device->GetInstance()->GetQueueFamilyIndices()[QueueFlags::Compute];
-    computePoolInfo.flags = 0;
+    computePoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if (vkCreateCommandPool(logicalDevice, &computePoolInfo, nullptr, &computeCommandPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create command pool");
@@ -62,16 +80,18 @@ void Renderer::CreateCommandPools() {
 }
 
 void Renderer::CreateRenderPass() {
+    TRACE_ZONE("Renderer::CreateRenderPass");
+
     // Color buffer attachment represented by one of the images from the swap chain
     VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = swapChain->GetVkImageFormat();
+    colorAttachment.format = renderTarget->GetVkImageFormat();
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = renderTarget->GetFinalLayout();
 
     // Create a color attachment reference to be used with subpass
     VkAttachmentReference colorAttachmentRef = {};
@@ -129,22 +149,88 @@ void Renderer::CreateRenderPass() {
 }
 
 void Renderer::CreateModels() {
-    VkCommandPoolCreateInfo transferPoolInfo = {};
-    transferPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    transferPoolInfo.queueFamilyIndex = device->GetInstance()->GetQueueFamilyIndices()[QueueFlags::Transfer];
-    transferPoolInfo.flags = 0;
+    TRACE_ZONE("Renderer::CreateModels");
 
-    VkCommandPool transferCommandPool;
-    if (vkCreateCommandPool(device->GetVkDevice(), &transferPoolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create command pool");
+    // BufferUtils::CopyBuffer submits on the graphics queue, the pool has to be of its family
+    backgroundQuad = new Model(device, graphicsCommandPool, ModelCreateFlags::BACKGROUND_QUAD);
+}
+
+void Renderer::CreateFrameSlots() {
+    TRACE_ZONE("Renderer::CreateFrameSlots");
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    // Signaled so the first wait on every slot returns immediately
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    VkSemaphoreTypeCreateInfo timelineTypeInfo = {};
+    timelineTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineTypeInfo.initialValue = frameNumber;
+
+    VkSemaphoreCreateInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineInfo.pNext = &timelineTypeInfo;
+
+    if (vkCreateSemaphore(logicalDevice, &timelineInfo, nullptr, &computeTimelineSemaphore) != VK_SUCCESS ||
+        vkCreateSemaphore(logicalDevice, &timelineInfo, nullptr, &graphicsTimelineSemaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timeline semaphores");
+    }
+
+    for (FrameSlot& frame : frames) {
+        if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &frame.fence) != VK_SUCCESS ||
+            vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS ||
+            vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &frame.renderFinishedSemaphore) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create frame synchronization objects");
+        }
+
+        frame.uiControlBuffer.MapMemory(device, sizeof(UIControlBufferObject));
+        memcpy(frame.uiControlBuffer.mappedData, &uiControlBufferObject, sizeof(UIControlBufferObject));
+
+        // The only command buffer allocations of the slot, the sequence ones are there even without a sequence
+        AllocateCommandBuffers(graphicsCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1, &frame.commandBuffer);
+        AllocateCommandBuffers(graphicsCommandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1, &frame.postCommandBuffer);
+        AllocateCommandBuffers(graphicsCommandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1, &frame.uiCommandBuffer);
+        AllocateCommandBuffers(computeCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, ComputePhaseCount, frame.computeCommandBuffers);
+        AllocateCommandBuffers(computeCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, VolumeSequencePlayer::TEXTURE_COUNT * ComputePhaseCount, frame.sequenceComputeCommandBuffers[0]);
     }
+    std::cout << "Rendering with " << frames.size() << " frames in flight" << std::endl;
+}
 
-    backgroundQuad = new Model(device, transferCommandPool, ModelCreateFlags::BACKGROUND_QUAD);
+void Renderer::DestroyFrameSlots() {
+    for (FrameSlot& frame : frames) {
+        VkCommandBuffer graphicsCommandBuffers[] = { frame.commandBuffer, frame.postCommandBuffer, frame.uiCommandBuffer };
+        vkFreeCommandBuffers(logicalDevice, graphicsCommandPool, 3, graphicsCommandBuffers);
+        vkFreeCommandBuffers(logicalDevice, computeCommandPool, ComputePhaseCount, frame.computeCommandBuffers);
+        vkFreeCommandBuffers(logicalDevice, computeCommandPool, VolumeSequencePlayer::TEXTURE_COUNT * ComputePhaseCount, frame.sequenceComputeCommandBuffers[0]);
+        vkDestroyFence(logicalDevice, frame.fence, nullptr);
+        vkDestroySemaphore(logicalDevice, frame.imageAvailableSemaphore, nullptr);
+        vkDestroySemaphore(logicalDevice, frame.renderFinishedSemaphore, nullptr);
+        frame.uiControlBuffer.Clean(device);
+    }
+    vkDestroySemaphore(logicalDevice, computeTimelineSemaphore, nullptr);
+    vkDestroySemaphore(logicalDevice, graphicsTimelineSemaphore, nullptr);
+}
+
+void Renderer::AllocateCommandBuffers(VkCommandPool commandPool, VkCommandBufferLevel level, uint32_t count, VkCommandBuffer* commandBuffers) {
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = level;
+    allocInfo.commandBufferCount = count;
 
-    vkDestroyCommandPool(device->GetVkDevice(), transferCommandPool, nullptr);
+    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate command buffers");
+    }
+    commandBufferAllocationCount += count;
 }
 
 void Renderer::CreateDescriptors() {
+    TRACE_ZONE("Renderer::CreateDescriptors");
+
     Descriptor::CreateImageStorageDescriptorSetLayout(logicalDevice);
     Descriptor::CreateImageDescriptorSetLayout(logicalDevice);
     Descriptor::CreateCameraDescriptorSetLayout(logicalDevice);
@@ -153,7 +239,7 @@ void Renderer::CreateDescriptors() {
     Descriptor::CreateSceneDescriptorSetLayout(logicalDevice);
     Descriptor::CreateUIParamDescriptorSetLayout(logicalDevice);
 
-    Descriptor::CreateDescriptorPool(logicalDevice, scene);
+    Descriptor::CreateDescriptorPool(logicalDevice, scene, static_cast<uint32_t>(frames.size()));
 
     // Storage image - cur, prev, near cloud
     Descriptor::CreateImageStorageDescriptorSet(logicalDevice, imageCurTexture, Descriptor::imageCurDescriptorSet);
@@ -177,68 +263,124 @@ void Renderer::CreateDescriptors() {
 
     // Image - Compute Nubis Cubed shader images
     Descriptor::CreateComputeNubisCubedImagesDescriptorSet(logicalDevice, modelingDataParkourTexture, modelingDataStormBirdTexture, cloudDetailNoiseTexture);
+    Descriptor::UpdateSparseVolumeDescriptorSet(logicalDevice, sparseVolumePlaceholder, Descriptor::computeNubisCubedImagesDescriptorSet);
 
-    // Camera
-    Descriptor::CreateCameraDescriptorSet(logicalDevice, camera);
-
-    // Scene (Time) 
-    Descriptor::CreateSceneDescriptorSet(logicalDevice, scene);
+    // Camera, Scene (Time) and UI, one of each per frame in flight
+    for (uint32_t i = 0; i < frames.size(); ++i) {
+        Descriptor::CreateCameraDescriptorSet(logicalDevice, camera, i, frames[i].cameraDescriptorSet);
+        Descriptor::CreateSceneDescriptorSet(logicalDevice, scene, i, frames[i].sceneDescriptorSet);
+        Descriptor::CreateUIParamDescriptorSet(logicalDevice, frames[i].uiControlBuffer.buffer, sizeof(UIControlBufferObject), frames[i].uiParamDescriptorSet);
+    }
+    BindFrameDescriptorSets(frameIndex);
+}
 
-    // UI
-    Descriptor::CreateUIParamDescriptorSet(logicalDevice, uiControlBuffer.buffer, sizeof(UIControlBufferObject));
+void Renderer::BindFrameDescriptorSets(uint32_t frame) {
+    Descriptor::cameraDescriptorSet = frames[frame].cameraDescriptorSet;
+    Descriptor::sceneDescriptorSet = frames[frame].sceneDescriptorSet;
+    Descriptor::uiParamDescriptorSet = frames[frame].uiParamDescriptorSet;
 }
 
 void Renderer::CreatePipelines() {
-    backgroundShader = new PostShader(device, swapChain, &renderPass, "shaders/post.vert.spv", "shaders/tone.frag.spv");
-    // reprojectShader = new ReprojectShader(device, swapChain, &renderPass);
-    computeShader = new ComputeShader(device, swapChain, &renderPass);
-    computeNubisCubedShader = new ComputeNubisCubedShader(device, swapChain, &renderPass);
-    computeLightGridShader = new ComputeLightGridShader(device, swapChain, &renderPass);
-    computeNearShader = new ComputeNearShader(device, swapChain, &renderPass);
-    computeFarShader = new ComputeFarShader(device, swapChain, &renderPass);
+    TRACE_ZONE("Renderer::CreatePipelines");
+
+    backgroundShader = new PostShader(device, renderTarget, &renderPass, "shaders/post.vert.spv", "shaders/tone.frag.spv");
+    // reprojectShader = new ReprojectShader(device, renderTarget, &renderPass);
+    computeShader = new ComputeShader(device, renderTarget, &renderPass);
+    computeNubisCubedShader = new ComputeNubisCubedShader(device, renderTarget, &renderPass);
+    computeLightGridShader = new ComputeLightGridShader(device, renderTarget, &renderPass);
+    computeNearShader = new ComputeNearShader(device, renderTarget, &renderPass);
+    computeFarShader = new ComputeFarShader(device, renderTarget, &renderPass);
 }
 
-void Renderer::CreateFrameResources() {
-    imageViews.resize(swapChain->GetCount());
+void Renderer::CreateStaticResources() {
+    TRACE_ZONE("Renderer::CreateStaticResources");
 
     const std::filesystem::path src_dir = std::filesystem::path(PROJECT_DIRECTORY);
 
-    // CREATE CUSTOM TEXTURES
-    depthTexture = Image::CreateDepthTexture(device, graphicsCommandPool, swapChain->GetVkExtent()); // Special for depth texture
+    // All transitions and copies below go out in a single submission
+    UploadBatch uploadBatch(device, graphicsCommandPool);
 
-    // Two ping pong images for reprojection and compute
-    imageCurTexture = Image::CreateStorageTexture(device, graphicsCommandPool, swapChain->GetVkExtent());
-    // imagePrevTexture = Image::CreateStorageTexture(device, graphicsCommandPool, swapChain->GetVkExtent());
+    // The volumes start out as empty placeholders and are swapped in by Frame() once streamed,
+    // so the first frame only waits on the small 2D textures
+    assetStreamer = new AssetStreamer(device);
+    assetStreamer->RequestTexture3D((src_dir / "images/hiResCloudShape/hiResClouds ").string(), glm::ivec3(32, 32, 32), &hiResCloudShapeTexture, &uploadBatch);
+    assetStreamer->RequestTexture3D((src_dir / "images/lowResCloudShape/lowResCloud").string(), glm::ivec3(128, 128, 128), &lowResCloudShapeTexture, &uploadBatch);
 
     // Create images to sample in the shader
-    hiResCloudShapeTexture = Image::CreateTexture3DFromFiles(device, graphicsCommandPool, (src_dir / "images/hiResCloudShape/hiResClouds ").string().c_str(), glm::ivec3(32, 32, 32));
-    lowResCloudShapeTexture = Image::CreateTexture3DFromFiles(device, graphicsCommandPool, (src_dir / "images/lowResCloudShape/lowResCloud").string().c_str(), glm::ivec3(128, 128, 128));
-    weatherMapTexture = Image::CreateTextureFromFile(device, graphicsCommandPool, (src_dir / "images/weather.png").string().c_str());
-    curlNoiseTexture = Image::CreateTextureFromFile(device, graphicsCommandPool, (src_dir / "images/curlNoise.png").string().c_str());
+    weatherMapTexture = Image::CreateTextureFromFile(device, graphicsCommandPool, (src_dir / "images/weather.png").string().c_str(), &uploadBatch);
+    curlNoiseTexture = Image::CreateTextureFromFile(device, graphicsCommandPool, (src_dir / "images/curlNoise.png").string().c_str(), &uploadBatch);
 
     // modelingDataTexture = Image::CreateTextureFromVDBFile(device, graphicsCommandPool, "images/vdb/example2/StormbirdCloud.vdb");
     
-    modelingDataParkourTexture = Image::CreateTexture3DFromFiles(device, graphicsCommandPool, (src_dir / "images/vdb/example1/tga/modeling_data").string().c_str(), glm::ivec3(512, 512, 64));
-    modelingDataStormBirdTexture = Image::CreateTexture3DFromFiles(device, graphicsCommandPool, (src_dir / "images/vdb/example2/tga/modeling_data").string().c_str(), glm::ivec3(512, 512, 64));
-    // fieldDataTexture = Image::CreateTexture3DFromFiles(device, graphicsCommandPool, (src_dir / "images/vdb/example2/tga/field_data").string().c_str(), glm::ivec3(512, 512, 64));
-    cloudDetailNoiseTexture = Image::CreateTexture3DFromFiles(device, graphicsCommandPool, (src_dir / "images/noise/tga/NubisVoxelCloudNoise").string().c_str(), glm::ivec3(128, 128, 128));
+    // Indexed by uiControlBufferObject.cloud_type, loaded when selected
+    modelingDataResidency = new VolumeResidency(assetStreamer, MODELING_DATA_BUDGET);
+    modelingDataResidency->Add((src_dir / "images/vdb/example1/tga/modeling_data").string(), glm::ivec3(512, 512, 64), &modelingDataParkourTexture, &uploadBatch);
+    modelingDataResidency->Add((src_dir / "images/vdb/example2/tga/modeling_data").string(), glm::ivec3(512, 512, 64), &modelingDataStormBirdTexture, &uploadBatch);
+    // fieldDataTexture = Image::CreateTexture3D(device, graphicsCommandPool, (src_dir / "images/vdb/example2/tga/field_data").string().c_str(), glm::ivec3(512, 512, 64));
+    assetStreamer->RequestTexture3D((src_dir / "images/noise/tga/NubisVoxelCloudNoise").string(), glm::ivec3(128, 128, 128), &cloudDetailNoiseTexture, &uploadBatch);
 
     // Light grid 
-    lightGridTexture = Image::CreateStorageTexture3D(device, graphicsCommandPool, glm::ivec3(256, 256, 32));
+    // Half the modeling resolution, resized by UpdateVolumeLayout once the real volume is in
+    lightGridDimension = glm::ivec3(uiControlBufferObject.voxel_dimension) / 2;
+    lightGridTexture = Image::CreateStorageTexture3D(device, graphicsCommandPool, lightGridDimension, &uploadBatch);
+
+    // Never read, the shaders only sample binding 3 once a sparse volume is loaded
+    BufferUtils::CreateBuffer(device, 256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sparseVolumePlaceholder, sparseVolumePlaceholderMemory);
+
+    uploadBatch.Submit();
+    device->GetAllocator()->PrintStats();
+}
+
+void Renderer::DestroyStaticResources() {
+    hiResCloudShapeTexture->CleanUp(device);
+    delete hiResCloudShapeTexture;
+    lowResCloudShapeTexture->CleanUp(device);
+    delete lowResCloudShapeTexture;
+    weatherMapTexture->CleanUp(device);
+    delete weatherMapTexture;
+    curlNoiseTexture->CleanUp(device);
+    delete curlNoiseTexture;
+    modelingDataParkourTexture->CleanUp(device);
+    delete modelingDataParkourTexture;
+    modelingDataStormBirdTexture->CleanUp(device);
+    delete modelingDataStormBirdTexture;
+    cloudDetailNoiseTexture->CleanUp(device);
+	delete cloudDetailNoiseTexture;
+    lightGridTexture->CleanUp(device);
+    delete lightGridTexture;
+    BufferUtils::DestroyBuffer(device, sparseVolumePlaceholder, sparseVolumePlaceholderMemory);
+}
+
+void Renderer::CreateFrameResources() {
+    TRACE_ZONE("Renderer::CreateFrameResources");
+
+    imageViews.resize(renderTarget->GetCount());
+
+    // Only what depends on the swapchain extent lives here, see CreateStaticResources for the rest
+    UploadBatch uploadBatch(device, graphicsCommandPool);
+
+    // CREATE CUSTOM TEXTURES
+    depthTexture = Image::CreateDepthTexture(device, graphicsCommandPool, renderTarget->GetVkExtent(), &uploadBatch); // Special for depth texture
+
+    // Two ping pong images for reprojection and compute
+    imageCurTexture = Image::CreateStorageTexture(device, graphicsCommandPool, renderTarget->GetVkExtent(), &uploadBatch);
+    // imagePrevTexture = Image::CreateStorageTexture(device, graphicsCommandPool, renderTarget->GetVkExtent());
 
     // Near Cloud 
-    nearCloudColorTexture = Image::CreateStorageTextureHalfRes(device, graphicsCommandPool, swapChain->GetVkExtent());
-    nearCloudDensityTexture = Image::CreateStorageTextureHalfRes(device, graphicsCommandPool, swapChain->GetVkExtent());
+    nearCloudColorTexture = Image::CreateStorageTextureHalfRes(device, graphicsCommandPool, renderTarget->GetVkExtent(), &uploadBatch);
+    nearCloudDensityTexture = Image::CreateStorageTextureHalfRes(device, graphicsCommandPool, renderTarget->GetVkExtent(), &uploadBatch);
 
-    for (uint32_t i = 0; i < swapChain->GetCount(); i++) {
+    uploadBatch.Submit();
+
+    for (uint32_t i = 0; i < renderTarget->GetCount(); i++) {
         // --- Create an image view for each swap chain image ---
         VkImageViewCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        createInfo.image = swapChain->GetVkImage(i);
+        createInfo.image = renderTarget->GetVkImage(i);
 
         // Specify how the image data should be interpreted
         createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        createInfo.format = swapChain->GetVkImageFormat();
+        createInfo.format = renderTarget->GetVkImageFormat();
 
         // Specify color channel mappings (can be used for swizzling)
         createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -260,8 +402,8 @@ void Renderer::CreateFrameResources() {
     }
     
     // CREATE FRAMEBUFFERS
-    framebuffers.resize(swapChain->GetCount());
-    for (size_t i = 0; i < swapChain->GetCount(); i++) {
+    framebuffers.resize(renderTarget->GetCount());
+    for (size_t i = 0; i < renderTarget->GetCount(); i++) {
         std::vector<VkImageView> attachments = {
             imageViews[i],
             depthTexture->imageView
@@ -272,8 +414,8 @@ void Renderer::CreateFrameResources() {
         framebufferInfo.renderPass = renderPass;
         framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChain->GetVkExtent().width;
-        framebufferInfo.height = swapChain->GetVkExtent().height;
+        framebufferInfo.width = renderTarget->GetVkExtent().width;
+        framebufferInfo.height = renderTarget->GetVkExtent().height;
         framebufferInfo.layers = 1;
 
         if (vkCreateFramebuffer(logicalDevice, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
@@ -288,31 +430,15 @@ void Renderer::DestroyFrameResources() {
         vkDestroyImageView(logicalDevice, imageViews[i], nullptr);
     }
 
-    depthTexture->CleanUp(logicalDevice);
+    depthTexture->CleanUp(device);
     delete depthTexture;
-    imageCurTexture->CleanUp(logicalDevice);
+    imageCurTexture->CleanUp(device);
     delete imageCurTexture;
-    // imagePrevTexture->CleanUp(logicalDevice);
+    // imagePrevTexture->CleanUp(device);
     // delete imagePrevTexture;
-    hiResCloudShapeTexture->CleanUp(logicalDevice);
-    delete hiResCloudShapeTexture;
-    lowResCloudShapeTexture->CleanUp(logicalDevice);
-    delete lowResCloudShapeTexture;
-    weatherMapTexture->CleanUp(logicalDevice);
-    delete weatherMapTexture;
-    curlNoiseTexture->CleanUp(logicalDevice);
-    delete curlNoiseTexture;
-    modelingDataParkourTexture->CleanUp(logicalDevice);
-    delete modelingDataParkourTexture;
-    modelingDataStormBirdTexture->CleanUp(logicalDevice);
-    delete modelingDataStormBirdTexture;
-    cloudDetailNoiseTexture->CleanUp(logicalDevice);
-	delete cloudDetailNoiseTexture;
-    lightGridTexture->CleanUp(logicalDevice);
-    delete lightGridTexture;
-    nearCloudColorTexture->CleanUp(logicalDevice);
+    nearCloudColorTexture->CleanUp(device);
     delete nearCloudColorTexture;
-    nearCloudDensityTexture->CleanUp(logicalDevice);
+    nearCloudDensityTexture->CleanUp(device);
     delete nearCloudDensityTexture;
 
     for (size_t i = 0; i < framebuffers.size(); i++) {
@@ -321,114 +447,326 @@ void Renderer::DestroyFrameResources() {
 }
 
 void Renderer::RecreateFrameResources() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Every frame in flight references the old targets
+    vkDeviceWaitIdle(logicalDevice);
+
     backgroundShader->CleanUp();
-    vkFreeCommandBuffers(logicalDevice, graphicsCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 
+    // Static volumes, noise and the light grid are untouched, only the swapchain sized targets are rebuilt
     DestroyFrameResources();
     CreateFrameResources();
+    UpdateFrameDescriptorSets();
 
     backgroundShader->CreateShaderProgram();
-    commandBuffers.resize(swapChain->GetCount());
-    //RecordCommandBuffers();
+    // The post pipeline bakes in the viewport
+    RecordPostCommandBuffers();
+
+    // Dispatch sizes depend on the extent
+    RecordComputeCommandBuffer();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Recreated frame resources (" << renderTarget->GetVkExtent().width << "x" << renderTarget->GetVkExtent().height
+              << ") in " << elapsed.count() << " ms" << std::endl;
 }
 
-void Renderer::RecordComputeCommandBuffer() {
-    // Specify the command pool and number of buffers to allocate
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = computeCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
+void Renderer::UpdateFrameDescriptorSets() {
+    // Same sets as in CreateDescriptors, rewritten in place to point at the recreated textures
+    Descriptor::UpdateImageStorageDescriptorSet(logicalDevice, imageCurTexture, Descriptor::imageCurDescriptorSet);
 
-    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, &computeCommandBuffer) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers");
+    Descriptor::UpdateImageStorageDescriptorSet(logicalDevice, nearCloudColorTexture, Descriptor::nearCloudColorDescriptorSet);
+    Descriptor::UpdateImageDescriptorSet(logicalDevice, nearCloudColorTexture, Descriptor::nearCloudColorSamplerDescriptorSet);
+    Descriptor::UpdateImageStorageDescriptorSet(logicalDevice, nearCloudDensityTexture, Descriptor::nearCloudDensityDescriptorSet);
+    Descriptor::UpdateImageDescriptorSet(logicalDevice, nearCloudDensityTexture, Descriptor::nearCloudDensitySamplerDescriptorSet);
+
+    Descriptor::UpdateImageDescriptorSet(logicalDevice, imageCurTexture, Descriptor::frameDescriptorSet);
+}
+
+void Renderer::UpdateStreamedDescriptorSets() {
+    // AssetStreamer::Update() already waited for the queues, nothing in flight uses these sets
+    Descriptor::UpdateComputeImagesDescriptorSet(logicalDevice, lowResCloudShapeTexture, hiResCloudShapeTexture, weatherMapTexture, curlNoiseTexture);
+    Descriptor::UpdateComputeNubisCubedImagesDescriptorSet(logicalDevice, modelingDataParkourTexture, modelingDataStormBirdTexture, cloudDetailNoiseTexture);
+
+    if (sequencePlayer) {
+        UpdateSequenceDescriptorSets();
+    }
+
+    // Updating a bound set invalidates the recorded dispatches
+    RecordComputeCommandBuffer();
+}
+
+void Renderer::UpdateVolumeLayout() {
+    VolumeLayout layout;
+    if (sparseVolume && useSparseVolume) {
+        layout = VolumeLayout::Make(sparseVolume->GetDimension(), sparseVolume->GetBoundsMin(), sparseVolume->GetBoundsMax());
+        uiControlBufferObject.sparse_index_min = glm::ivec4(sparseVolume->GetIndexMin(), 1);
+        uiControlBufferObject.sparse_grid_offsets = sparseVolume->GetGridOffsets();
+    } else {
+        uiControlBufferObject.sparse_index_min.w = 0;
+
+        Texture* modeling;
+        if (sequencePlayer) {
+            modeling = sequencePlayer->GetTexture(sequencePlayer->GetFrontIndex());
+        } else {
+            modeling = uiControlBufferObject.cloud_type == 0 ? modelingDataParkourTexture : modelingDataStormBirdTexture;
+        }
+
+        // Placeholders keep the layout of the previous volume
+        if (modeling->dimension == glm::ivec3(0)) {
+            return;
+        }
+        layout = VolumeLayout::Make(modeling->dimension, modeling->boundsMin, modeling->boundsMax);
+    }
+
+    uiControlBufferObject.voxel_bound_min = glm::vec4(layout.boundsMin, 0.0f);
+    uiControlBufferObject.voxel_bound_max = glm::vec4(layout.boundsMax, 0.0f);
+    uiControlBufferObject.voxel_dimension = glm::ivec4(layout.dimension, 0);
+    if (layout.lightGridDimension != lightGridDimension) {
+        ResizeLightGrid(layout.lightGridDimension);
+    }
+}
+
+void Renderer::ResizeLightGrid(glm::ivec3 dimension) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Only happens when a volume of another resolution comes on screen, the dispatches in flight write the old grid
+    vkDeviceWaitIdle(logicalDevice);
+
+    vkDestroySampler(logicalDevice, lightGridTexture->sampler, nullptr);
+    lightGridTexture->CleanUp(device);
+    delete lightGridTexture;
+
+    lightGridDimension = dimension;
+    lightGridTexture = Image::CreateStorageTexture3D(device, graphicsCommandPool, lightGridDimension);
+    Descriptor::UpdateImageStorageDescriptorSet(logicalDevice, lightGridTexture, Descriptor::lightGridDescriptorSet);
+    Descriptor::UpdateImageDescriptorSet(logicalDevice, lightGridTexture, Descriptor::lightGridSamplerDescriptorSet);
+
+    // Dispatch sizes depend on the grid
+    RecordComputeCommandBuffer();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Resized light grid to " << dimension.x << "x" << dimension.y << "x" << dimension.z << " in " << elapsed.count() << " ms" << std::endl;
+}
+
+void Renderer::PlaySequence(const std::string& pattern, float framesPerSecond) {
+    // Throws before anything is replaced if the sequence cannot be loaded
+    // .vdb frames are resampled to the resolution of the modeling volume on screen
+    VolumeSequencePlayer* player = new VolumeSequencePlayer(device, pattern, glm::ivec3(uiControlBufferObject.voxel_dimension), framesPerSecond);
+
+    // Only called between frames, but the recorded compute commands may still be in flight
+    vkDeviceWaitIdle(logicalDevice);
+
+    bool setsAllocated = sequencePlayer != nullptr;
+    delete sequencePlayer;
+    sequencePlayer = player;
+
+    if (!setsAllocated) {
+        for (uint32_t i = 0; i < VolumeSequencePlayer::TEXTURE_COUNT; ++i) {
+            Texture* texture = sequencePlayer->GetTexture(i);
+            Descriptor::CreateComputeNubisCubedImagesDescriptorSet(logicalDevice, texture, texture, cloudDetailNoiseTexture, sequenceDescriptorSets[i]);
+            Descriptor::UpdateSparseVolumeDescriptorSet(logicalDevice, sparseVolume ? sparseVolume->GetBuffer() : sparseVolumePlaceholder, sequenceDescriptorSets[i]);
+        }
+    } else {
+        UpdateSequenceDescriptorSets();
+    }
+
+    RecordComputeCommandBuffer();
+}
+
+void Renderer::LoadSparseVolume(const std::string& path) {
+    // Throws before anything is replaced if the file cannot be converted
+    SparseVolume* volume = new SparseVolume(device, graphicsCommandPool, path);
+
+    // Rewriting the sets invalidates the recorded compute commands, which may still be in flight
+    vkDeviceWaitIdle(logicalDevice);
+
+    delete sparseVolume;
+    sparseVolume = volume;
+    useSparseVolume = true;
+
+    Descriptor::UpdateSparseVolumeDescriptorSet(logicalDevice, sparseVolume->GetBuffer(), Descriptor::computeNubisCubedImagesDescriptorSet);
+    if (sequencePlayer) {
+        for (uint32_t i = 0; i < VolumeSequencePlayer::TEXTURE_COUNT; ++i) {
+            Descriptor::UpdateSparseVolumeDescriptorSet(logicalDevice, sparseVolume->GetBuffer(), sequenceDescriptorSets[i]);
+        }
+    }
+
+    RecordComputeCommandBuffer();
+}
+
+void Renderer::UpdateSequenceDescriptorSets() {
+    // The sequence stands in for both cloud types
+    for (uint32_t i = 0; i < VolumeSequencePlayer::TEXTURE_COUNT; ++i) {
+        Texture* texture = sequencePlayer->GetTexture(i);
+        Descriptor::UpdateComputeNubisCubedImagesDescriptorSet(logicalDevice, texture, texture, cloudDetailNoiseTexture, sequenceDescriptorSets[i]);
+    }
+}
+
+void Renderer::RecordComputeCommandBuffer() {
+    // Each frame slot gets its own dispatches, bound to the slot's camera, scene and UI sets
+    for (uint32_t f = 0; f < frames.size(); ++f) {
+        BindFrameDescriptorSets(f);
+        RecordComputeCommands(f, frames[f].computeCommandBuffers);
+
+        if (sequencePlayer) {
+            // The shaders bind Descriptor::computeNubisCubedImagesDescriptorSet, point it at each sequence
+            // texture's set while recording so a frame swap only picks another command buffer
+            VkDescriptorSet modelingDescriptorSet = Descriptor::computeNubisCubedImagesDescriptorSet;
+            for (uint32_t i = 0; i < VolumeSequencePlayer::TEXTURE_COUNT; ++i) {
+                Descriptor::computeNubisCubedImagesDescriptorSet = sequenceDescriptorSets[i];
+                RecordComputeCommands(f, frames[f].sequenceComputeCommandBuffers[i]);
+            }
+            Descriptor::computeNubisCubedImagesDescriptorSet = modelingDescriptorSet;
+        }
     }
+    BindFrameDescriptorSets(frameIndex);
+}
 
+void Renderer::RecordComputeCommands(uint32_t frame, VkCommandBuffer* commandBuffers) {
+    // A slot's buffers are never pending twice, its fence is waited on before they are resubmitted
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    beginInfo.flags = 0;
     beginInfo.pInheritanceInfo = nullptr;
 
-    // ~ Start recording ~
-    if (vkBeginCommandBuffer(computeCommandBuffer, &beginInfo) != VK_SUCCESS) {
+    // Orders the dispatches after the writes of the ones before, also across submissions on the compute queue
+    VkMemoryBarrier computeBarrier = {};
+    computeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    computeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    computeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    const glm::ivec2 texDimsPartial(renderTarget->GetVkExtent().width, renderTarget->GetVkExtent().height);
+
+    // ~ Start recording ~ (implicitly resets the buffer)
+    VkCommandBuffer commandBuffer = commandBuffers[LightingPhase];
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("Failed to begin recording compute command buffer");
     }
 
+    profiler->RecordReset(commandBuffer, frame, true);
+
+    // The previous frame's far clouds sample the light grid and near clouds this overwrites
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, nullptr, 0, nullptr);
+
     // Reproject
-    // reprojectShader->BindShaderProgram(computeCommandBuffers[i]);
-    // const glm::ivec2 texDimsFull(swapChain->GetVkExtent().width, swapChain->GetVkExtent().height);
-    // vkCmdDispatch(computeCommandBuffers[i],
+    // reprojectShader->BindShaderProgram(commandBuffers[i]);
+    // const glm::ivec2 texDimsFull(renderTarget->GetVkExtent().width, renderTarget->GetVkExtent().height);
+    // vkCmdDispatch(commandBuffers[i],
     //     static_cast<uint32_t>((texDimsFull.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
     //     static_cast<uint32_t>((texDimsFull.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
     //     1);
 
-
+    // Both passes are timed without Nubis Cubed too, they just come out empty
+    profiler->RecordBegin(commandBuffer, frame, LightGridPass);
     if (useNubisCubed == 1) {
         // Light Grid Compute Shader
-        const glm::ivec3 lightVoxelDims(256, 256, 32);
-        computeLightGridShader->BindShaderProgram(computeCommandBuffer);
-        vkCmdDispatch(computeCommandBuffer,
-            static_cast<uint32_t>((lightVoxelDims.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
-            static_cast<uint32_t>((lightVoxelDims.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
-            static_cast<uint32_t>((lightVoxelDims.z)));
-
-        computeNearShader->BindShaderProgram(computeCommandBuffer);
-        const glm::ivec2 texDimsPartial(swapChain->GetVkExtent().width, swapChain->GetVkExtent().height);
-        vkCmdDispatch(computeCommandBuffer,
+        computeLightGridShader->BindShaderProgram(commandBuffer);
+        vkCmdDispatch(commandBuffer,
+            static_cast<uint32_t>((lightGridDimension.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
+            static_cast<uint32_t>((lightGridDimension.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
+            static_cast<uint32_t>((lightGridDimension.z)));
+
+        // The near clouds sample the light grid
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, nullptr, 0, nullptr);
+    }
+    profiler->RecordEnd(commandBuffer, frame, LightGridPass);
+
+    profiler->RecordBegin(commandBuffer, frame, NearCloudPass);
+    if (useNubisCubed == 1) {
+        computeNearShader->BindShaderProgram(commandBuffer);
+        vkCmdDispatch(commandBuffer,
             static_cast<uint32_t>((texDimsPartial.x / 2 + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
             static_cast<uint32_t>((texDimsPartial.y / 2 + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
             1);
+    }
+    profiler->RecordEnd(commandBuffer, frame, NearCloudPass);
 
-        computeFarShader->BindShaderProgram(computeCommandBuffer);
-        vkCmdDispatch(computeCommandBuffer,
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record compute command buffer");
+    }
+
+    commandBuffer = commandBuffers[CompositePhase];
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording compute command buffer");
+    }
+
+    // Every pixel of imageCurTexture is rewritten, discard it instead of taking it back from the graphics family.
+    // The submission waited for the post pass that sampled it.
+    uint32_t computeFamily = device->GetQueueIndex(QueueFlags::Compute);
+    uint32_t graphicsFamily = device->GetQueueIndex(QueueFlags::Graphics);
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = imageCurTexture->image;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, nullptr, 1, &imageBarrier);
+
+    // The single pass without Nubis Cubed counts as the far clouds
+    profiler->RecordBegin(commandBuffer, frame, FarCloudPass);
+    if (useNubisCubed == 1) {
+        computeFarShader->BindShaderProgram(commandBuffer);
+        vkCmdDispatch(commandBuffer,
             static_cast<uint32_t>((texDimsPartial.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
             static_cast<uint32_t>((texDimsPartial.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
             1);
 
         /*
-            computeNubisCubedShader->BindShaderProgram(computeCommandBuffer);
-            const glm::ivec2 texDimsPartial(swapChain->GetVkExtent().width, swapChain->GetVkExtent().height);
-            vkCmdDispatch(computeCommandBuffer,
+            computeNubisCubedShader->BindShaderProgram(commandBuffer);
+            const glm::ivec2 texDimsPartial(renderTarget->GetVkExtent().width, renderTarget->GetVkExtent().height);
+            vkCmdDispatch(commandBuffer,
                 static_cast<uint32_t>((texDimsPartial.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
                 static_cast<uint32_t>((texDimsPartial.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
                 1);
         */
     } else {
-        computeShader->BindShaderProgram(computeCommandBuffer);
-        const glm::ivec2 texDimsFull(swapChain->GetVkExtent().width, swapChain->GetVkExtent().height);
-        // const glm::ivec2 texDimsPartial(swapChain->GetVkExtent().width / 4, swapChain->GetVkExtent().height / 4);
-        vkCmdDispatch(computeCommandBuffer,
+        computeShader->BindShaderProgram(commandBuffer);
+        const glm::ivec2 texDimsFull(renderTarget->GetVkExtent().width, renderTarget->GetVkExtent().height);
+        // const glm::ivec2 texDimsPartial(renderTarget->GetVkExtent().width / 4, renderTarget->GetVkExtent().height / 4);
+        vkCmdDispatch(commandBuffer,
             static_cast<uint32_t>((texDimsFull.x + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
             static_cast<uint32_t>((texDimsFull.y + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE),
             1);
     }
+    profiler->RecordEnd(commandBuffer, frame, FarCloudPass);
+
+    // Release to the graphics family, RecordCommandBuffer acquires it
+    if (computeFamily != graphicsFamily) {
+        imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.dstAccessMask = 0;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcQueueFamilyIndex = computeFamily;
+        imageBarrier.dstQueueFamilyIndex = graphicsFamily;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+    }
 
     // ~ End recording ~
-    if (vkEndCommandBuffer(computeCommandBuffer) != VK_SUCCESS) {
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("Failed to record compute command buffer");
     }
 }
 
 void Renderer::RecordCommandBuffer(uint32_t index) {
-    // Specify the command pool and number of buffers to allocate
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = graphicsCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    FrameSlot& frame = frames[frameIndex];
 
-    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers");
+    bool drawUI = USE_UI && HasUI();
+    if (drawUI) {
+        RecordUICommandBuffer(index);
     }
 
-    // Start command buffer recording
+    // The slot's fence has signaled, beginning the buffer again resets it
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = nullptr;
 
     // ~ Start recording ~
-    if (vkBeginCommandBuffer(commandBuffers[index], &beginInfo) != VK_SUCCESS) {
+    if (vkBeginCommandBuffer(frame.commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("Failed to begin recording command buffer");
     }
 
@@ -438,7 +776,7 @@ void Renderer::RecordCommandBuffer(uint32_t index) {
     renderPassInfo.renderPass = renderPass;
     renderPassInfo.framebuffer = framebuffers[index];
     renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = swapChain->GetVkExtent();
+    renderPassInfo.renderArea.extent = renderTarget->GetVkExtent();
 
     std::array<VkClearValue, 2> clearValues = {};
     clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -446,24 +784,161 @@ void Renderer::RecordCommandBuffer(uint32_t index) {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffers[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    // Bind the graphics pipeline
-    backgroundShader->BindShaderProgram(commandBuffers[index]);
-    backgroundQuad->EnqueueDrawCommands(commandBuffers[index]);
+    profiler->RecordReset(frame.commandBuffer, frameIndex, false);
+
+    // Acquire imageCurTexture from the compute family, the submission waited for its release
+    uint32_t computeFamily = device->GetQueueIndex(QueueFlags::Compute);
+    uint32_t graphicsFamily = device->GetQueueIndex(QueueFlags::Graphics);
+    if (computeFamily != graphicsFamily) {
+        VkImageMemoryBarrier imageBarrier = {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = 0;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcQueueFamilyIndex = computeFamily;
+        imageBarrier.dstQueueFamilyIndex = graphicsFamily;
+        imageBarrier.image = imageCurTexture->image;
+        imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+    }
+
+    // Post process, then the UI on top
+    vkCmdBeginRenderPass(frame.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    VkCommandBuffer secondaryCommandBuffers[] = { frame.postCommandBuffer, frame.uiCommandBuffer };
+    vkCmdExecuteCommands(frame.commandBuffer, drawUI ? 2 : 1, secondaryCommandBuffers);
+
+    //// End render pass
+    vkCmdEndRenderPass(frame.commandBuffer);
+
+    // ~ End recording ~
+    if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record command buffer");
+    }
+}
+
+void Renderer::RecordPostCommandBuffers() {
+    // Continues the render pass of the primary, any framebuffer of it
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    for (uint32_t f = 0; f < frames.size(); ++f) {
+        VkCommandBuffer& commandBuffer = frames[f].postCommandBuffer;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to begin recording command buffer");
+        }
+
+        // Bind the graphics pipeline with the slot's camera, scene and UI sets
+        BindFrameDescriptorSets(f);
+        profiler->RecordBegin(commandBuffer, f, PostPass);
+        backgroundShader->BindShaderProgram(commandBuffer);
+        backgroundQuad->EnqueueDrawCommands(commandBuffer);
+        profiler->RecordEnd(commandBuffer, f, PostPass);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record command buffer");
+        }
+    }
+    BindFrameDescriptorSets(frameIndex);
+}
+
+void Renderer::RecordUICommandBuffer(uint32_t index) {
+    VkCommandBuffer& uiCommandBuffer = frames[frameIndex].uiCommandBuffer;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffers[index];
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(uiCommandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording UI command buffer");
+    }
 
-#if USE_UI
-    // UI
     mouseOverImGuiWindow = io->WantCaptureMouse;
 
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
-    ImGui::SetNextWindowSize(ImVec2(500.f, 410.f));
+    ImGui::SetNextWindowSize(ImVec2(500.f, 530.f + (sequencePlayer ? 50.f : 0.f) + (sparseVolume ? 50.f : 0.f) + (profiler->IsSupported() ? 160.f : 0.f)));
     ImGui::Begin("Control Panel", 0, ImGuiWindowFlags_None | ImGuiWindowFlags_NoMove);
     ImGui::SetWindowFontScale(1);
 
     ImGui::Text("Current Frame Rate: %.1f", ImGui::GetIO().Framerate);
+    MemoryStats memoryStats = device->GetAllocator()->GetStats();
+    ImGui::Text("GPU Memory: %u MB in %u allocations (%u blocks, %u dedicated), %.0f%% fragmented",
+        static_cast<uint32_t>(memoryStats.usedBytes >> 20), memoryStats.deviceMemoryCount, memoryStats.blockCount,
+        memoryStats.dedicatedCount, memoryStats.fragmentation * 100.0f);
+    ImGui::Text("Memory + Command Buffer Allocations (other Vulkan objects not counted): %u last frame, %llu since startup", frameAllocationCount,
+        static_cast<unsigned long long>(lastAllocationCount));
+    ImGui::Text("Modeling Volumes: %u resident, %u / %u MB",
+        modelingDataResidency->GetResidentCount(),
+        static_cast<uint32_t>(modelingDataResidency->GetCommittedBytes() >> 20),
+        static_cast<uint32_t>(modelingDataResidency->GetBudget() >> 20));
+    if (!assetStreamer->IsIdle()) {
+        ImGui::Text("Streaming %u volumes...", assetStreamer->GetPendingCount());
+    }
+    DerivedDataStats cacheStats = DerivedDataCache::Get().GetStats();
+    ImGui::Text("Derived Data Cache: %u hits, %u misses, %u MB written",
+        cacheStats.hits, cacheStats.misses, static_cast<uint32_t>(cacheStats.bytesWritten >> 20));
+    if (sequencePlayer) {
+        ImGui::Text("Volume Sequence: frame %u / %u, %u late, %.1f ms decode",
+            sequencePlayer->GetFrame() + 1, sequencePlayer->GetFrameCount(),
+            sequencePlayer->GetLateFrameCount(), sequencePlayer->GetAverageDecodeMilliseconds());
+        bool playing = sequencePlayer->IsPlaying();
+        if (ImGui::Checkbox("Play", &playing)) {
+            sequencePlayer->SetPlaying(playing);
+        }
+        ImGui::SameLine();
+        float framesPerSecond = sequencePlayer->GetFramesPerSecond();
+        if (ImGui::SliderFloat("Sequence FPS", &framesPerSecond, 1.0f, 60.0f)) {
+            sequencePlayer->SetFramesPerSecond(framesPerSecond);
+        }
+    }
+    if (sparseVolume) {
+        // Averaged separately so switching back and forth compares the two paths on the same view
+        float& frameMilliseconds = useSparseVolume ? sparseFrameMilliseconds : denseFrameMilliseconds;
+        frameMilliseconds = frameMilliseconds == 0.0f ? io->DeltaTime * 1000.0f : glm::mix(frameMilliseconds, io->DeltaTime * 1000.0f, 0.05f);
+        ImGui::Text("Sparse Volume: %llu active voxels, %.1f MB (dense %.1f MB)",
+            static_cast<unsigned long long>(sparseVolume->GetActiveVoxelCount()),
+            sparseVolume->GetSize() / 1048576.0, sparseVolume->GetDenseSize() / 1048576.0);
+        ImGui::Checkbox("Sample NanoVDB", &useSparseVolume);
+        ImGui::SameLine();
+        ImGui::Text("dense %.2f ms, NanoVDB %.2f ms", denseFrameMilliseconds, sparseFrameMilliseconds);
+    }
+    if (profiler->IsSupported()) {
+        // A few frames behind, the queries are read once their frame slot comes around again
+        ImGui::Text("GPU Passes (ms over %u frames)   avg    p50    p95    p99%s", GpuProfiler::HISTORY_SIZE,
+            profiler->HasPipelineStatistics() ? "  invocations" : "");
+        for (uint32_t pass = 0; pass < GpuPassCount; ++pass) {
+            GpuProfiler::PassStats stats = profiler->GetStats(static_cast<GpuPass>(pass));
+            ImGui::Text("  %-12s %6.2f %6.2f %6.2f %6.2f", GpuProfiler::GetPassName(static_cast<GpuPass>(pass)),
+                stats.averageMilliseconds, stats.p50Milliseconds, stats.p95Milliseconds, stats.p99Milliseconds);
+            if (profiler->HasPipelineStatistics()) {
+                ImGui::SameLine();
+                ImGui::Text("%llu", static_cast<unsigned long long>(stats.invocations));
+            }
+        }
+        if (ImGui::Button("Export GPU Pass CSV")) {
+            if (profiler->WriteCsv("gpu_passes.csv")) {
+                std::cout << "Appended GPU pass timings to gpu_passes.csv" << std::endl;
+            }
+        }
+    }
     // ImGui::RadioButton("Nubis 2", &useNubisCubed, 0);
     // ImGui::SameLine();
     // ImGui::RadioButton("Nubis 3", &useNubisCubed, 1);
@@ -472,9 +947,20 @@ void Renderer::RecordCommandBuffer(uint32_t index) {
     ImGui::Text("Cloud Parameter");
     ImGui::SliderFloat("Tiling Frequency", &uiControlBufferObject.tiling_freq, 0.01f, 0.1f);
 
+    // Hovering a cloud type starts streaming its modeling volume before it is clicked
     ImGui::RadioButton("Parkouring Cloud", &uiControlBufferObject.cloud_type, 0);
+    if (ImGui::IsItemHovered()) {
+        modelingDataResidency->Prefetch(0);
+    }
     ImGui::SameLine();
     ImGui::RadioButton("Stormbird Cloud", &uiControlBufferObject.cloud_type, 1);
+    if (ImGui::IsItemHovered()) {
+        modelingDataResidency->Prefetch(1);
+    }
+    int modelingBudget = static_cast<int>(modelingDataResidency->GetBudget() >> 20);
+    if (ImGui::SliderInt("Modeling Budget (MB)", &modelingBudget, 64, 512)) {
+        modelingDataResidency->SetBudget(static_cast<VkDeviceSize>(modelingBudget) << 20);
+    }
 
     ImGui::Separator();
     ImGui::Text("Cloud Animation Parameter");
@@ -510,71 +996,12 @@ void Renderer::RecordCommandBuffer(uint32_t index) {
     ImGui::End();
 
     ImGui::Render();
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffers[index]);
-#endif
-
-    //// End render pass
-    vkCmdEndRenderPass(commandBuffers[index]);
+    profiler->RecordBegin(uiCommandBuffer, frameIndex, UIPass);
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), uiCommandBuffer);
+    profiler->RecordEnd(uiCommandBuffer, frameIndex, UIPass);
 
-    // ~ End recording ~
-    if (vkEndCommandBuffer(commandBuffers[index]) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to record command buffer");
-    }
-    
-}
-
-void Renderer::RecordCommandBuffers() {
-    commandBuffers.resize(swapChain->GetCount());
-
-    // Specify the command pool and number of buffers to allocate
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = graphicsCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers");
-    }
-
-    // Start command buffer recording
-    for (size_t i = 0; i < commandBuffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-        beginInfo.pInheritanceInfo = nullptr;
-
-        // ~ Start recording ~
-        if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to begin recording command buffer");
-        }
-
-        // Begin the render pass
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = framebuffers[i];
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = swapChain->GetVkExtent();
-
-        std::array<VkClearValue, 2> clearValues = {};
-        clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-        clearValues[1].depthStencil = { 1.0f, 0 };
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
-
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        // Bind the graphics pipeline
-        backgroundShader->BindShaderProgram(commandBuffers[i]);
-        backgroundQuad->EnqueueDrawCommands(commandBuffers[i]);
-
-        //// End render pass
-        vkCmdEndRenderPass(commandBuffers[i]);
-
-        // ~ End recording ~
-        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to record command buffer");
-        }
+    if (vkEndCommandBuffer(uiCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record UI command buffer");
     }
 }
 
@@ -582,70 +1009,137 @@ void Renderer::UpdateUniformBuffers() {
     scene->UpdateTime(customSunAngle, angle); // time
     camera->UpdatePrevBuffer(); // camera prev
     camera->UpdatePixelOffset(); // camera pixel offset
-    UpdateUIBuffer(); // ui control parameters
 }
 
 void Renderer::Frame() {
-    // RecordComputeCommandBuffer();
+    // The only CPU wait: the submission that last used this slot has to be done with its buffers
+    FrameSlot& frame = frames[frameIndex];
+    vkWaitForFences(logicalDevice, 1, &frame.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    profiler->Collect(frameIndex);
+
+    // Allocator and command buffer allocations made since the last frame started
+    uint64_t allocationCount = device->GetAllocator()->GetStats().totalAllocationCount + commandBufferAllocationCount;
+    frameAllocationCount = static_cast<uint32_t>(allocationCount - lastAllocationCount);
+    lastAllocationCount = allocationCount;
+
+    modelingDataResidency->SetActive(static_cast<uint32_t>(uiControlBufferObject.cloud_type));
+    modelingDataResidency->Update();
+    if (assetStreamer->Update()) {
+        UpdateStreamedDescriptorSets();
+    }
 
-    VkSubmitInfo computeSubmitInfo = {};
-    computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    UpdateVolumeLayout();
 
-    computeSubmitInfo.commandBufferCount = 1;
-    computeSubmitInfo.pCommandBuffers = &computeCommandBuffer;
-    // swap buffers
+    // Nothing is submitted for this slot if the swapchain is out of date, its fence stays signaled
+    if (!renderTarget->Acquire(frame.imageAvailableSemaphore)) {
+        RecreateFrameResources();
+        return;
+    }
 
-    if (vkQueueSubmit(device->GetQueue(QueueFlags::Compute), 1, &computeSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to submit draw command buffer");
+    // A sequence frame swap only selects the dispatches recorded against the other texture
+    VkCommandBuffer* computeCommands = frame.computeCommandBuffers;
+    VkFence computeFence = VK_NULL_HANDLE;
+    if (sequencePlayer) {
+        sequencePlayer->Update();
+        computeCommands = frame.sequenceComputeCommandBuffers[sequencePlayer->GetFrontIndex()];
+        computeFence = sequencePlayer->AcquireFrameFence();
     }
 
-    if (!swapChain->Acquire()) {
-        RecreateFrameResources();
-        return;
+    camera->UpdateBuffers(frameIndex);
+    scene->UpdateBuffer(frameIndex);
+    UpdateUIBuffer();
+
+    ++frameNumber;
+    uint64_t previousFrameNumber = frameNumber - 1;
+
+    // The lighting phase waits for nothing and overlaps the previous frame's post pass and UI.
+    // The composite phase overwrites imageCurTexture, which that post pass samples.
+    VkSubmitInfo computeSubmitInfos[ComputePhaseCount] = {};
+    computeSubmitInfos[LightingPhase].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    computeSubmitInfos[LightingPhase].commandBufferCount = 1;
+    computeSubmitInfos[LightingPhase].pCommandBuffers = &computeCommands[LightingPhase];
+
+    VkTimelineSemaphoreSubmitInfo computeTimelineInfo = {};
+    computeTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    computeTimelineInfo.waitSemaphoreValueCount = 1;
+    computeTimelineInfo.pWaitSemaphoreValues = &previousFrameNumber;
+    computeTimelineInfo.signalSemaphoreValueCount = 1;
+    computeTimelineInfo.pSignalSemaphoreValues = &frameNumber;
+
+    VkPipelineStageFlags computeWaitStages[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+    computeSubmitInfos[CompositePhase].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    computeSubmitInfos[CompositePhase].pNext = &computeTimelineInfo;
+    computeSubmitInfos[CompositePhase].waitSemaphoreCount = 1;
+    computeSubmitInfos[CompositePhase].pWaitSemaphores = &graphicsTimelineSemaphore;
+    computeSubmitInfos[CompositePhase].pWaitDstStageMask = computeWaitStages;
+    computeSubmitInfos[CompositePhase].commandBufferCount = 1;
+    computeSubmitInfos[CompositePhase].pCommandBuffers = &computeCommands[CompositePhase];
+    computeSubmitInfos[CompositePhase].signalSemaphoreCount = 1;
+    computeSubmitInfos[CompositePhase].pSignalSemaphores = &computeTimelineSemaphore;
+
+    // One submission so the sequence fence covers both phases
+    if (vkQueueSubmit(device->GetQueue(QueueFlags::Compute), ComputePhaseCount, computeSubmitInfos, computeFence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit draw command buffer");
     }
 
-    RecordCommandBuffer(swapChain->GetIndex());
+    BindFrameDescriptorSets(frameIndex);
+    RecordCommandBuffer(renderTarget->GetIndex());
 
     // Submit the command buffer
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = { swapChain->GetImageAvailableVkSemaphore() };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    // Values of binary semaphores are ignored
+    uint64_t waitValues[] = { 0, frameNumber };
+    uint64_t signalValues[] = { 0, frameNumber };
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 2;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    VkSemaphore waitSemaphores[] = { frame.imageAvailableSemaphore, computeTimelineSemaphore };
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+    submitInfo.waitSemaphoreCount = 2;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
-    VkSemaphore signalSemaphores[] = { swapChain->GetRenderFinishedVkSemaphore() };
-    submitInfo.signalSemaphoreCount = 1;
+    VkSemaphore signalSemaphores[] = { frame.renderFinishedSemaphore, graphicsTimelineSemaphore };
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[swapChain->GetIndex()];
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
 
-    if (vkQueueSubmit(device->GetQueue(QueueFlags::Graphics), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+    vkResetFences(logicalDevice, 1, &frame.fence);
+    if (vkQueueSubmit(device->GetQueue(QueueFlags::Graphics), 1, &submitInfo, frame.fence) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit draw command buffer");
     }
+    profiler->MarkSubmitted(frameIndex);
 
-    if (!swapChain->Present()) {
+    bool presented = renderTarget->Present(frame.renderFinishedSemaphore);
+    frameIndex = (frameIndex + 1) % static_cast<uint32_t>(frames.size());
+    if (!presented) {
         RecreateFrameResources();
     }
 }
 
 Renderer::~Renderer() {
-#if USE_UI
-    // UI cleanup
-    ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (HasUI()) {
+        // UI cleanup
+        ImGui_ImplVulkan_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
 
-    vkDestroyDescriptorPool(logicalDevice, uiDescriptorPool, nullptr);
-#endif
+        vkDestroyDescriptorPool(logicalDevice, uiDescriptorPool, nullptr);
+    }
 
     vkDeviceWaitIdle(logicalDevice);
 
     // TODO: destroy any resources you created
-    vkFreeCommandBuffers(logicalDevice, graphicsCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-    vkFreeCommandBuffers(logicalDevice, computeCommandPool, 1, &computeCommandBuffer);
+    DestroyFrameSlots();
+    delete profiler;
 
     // Destroy descrioptors and shader programs
     Descriptor::CleanUp(logicalDevice);
@@ -663,22 +1157,29 @@ Renderer::~Renderer() {
 
     vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
     DestroyFrameResources();
+    delete sequencePlayer;
+    delete sparseVolume;
+    delete modelingDataResidency;
+    delete assetStreamer;
+    DestroyStaticResources();
     vkDestroyCommandPool(logicalDevice, computeCommandPool, nullptr);
     vkDestroyCommandPool(logicalDevice, graphicsCommandPool, nullptr);
 }
 
 // UI section
 void Renderer::CreateUI() {
+    TRACE_ZONE("Renderer::CreateUI");
+
     // Create UI descriptor pool
     VkDescriptorPoolSize pool_sizes[] = {
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, swapChain->GetCount() },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, swapChain->GetCount() * 2 }
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, renderTarget->GetCount() },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, renderTarget->GetCount() * 2 }
     };
 
     VkDescriptorPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    pool_info.maxSets = swapChain->GetCount() * 2;
+    pool_info.maxSets = renderTarget->GetCount() * 2;
     pool_info.poolSizeCount = static_cast<uint32_t>(IM_ARRAYSIZE(pool_sizes));
     pool_info.pPoolSizes = pool_sizes;
     if (vkCreateDescriptorPool(logicalDevice, &pool_info, nullptr, &uiDescriptorPool) != VK_SUCCESS) {
@@ -693,7 +1194,8 @@ void Renderer::CreateUI() {
     init_info.Instance = device->GetInstance()->GetVkInstance();
     init_info.PhysicalDevice = device->GetInstance()->GetPhysicalDevice();
     init_info.Device = device->GetVkDevice();
-    init_info.ImageCount = swapChain->GetCount();
+    // The backend cycles its vertex and index buffers over ImageCount draws, so it needs at least one set per frame in flight
+    init_info.ImageCount = std::max(renderTarget->GetCount(), static_cast<uint32_t>(frames.size()));
     init_info.MinImageCount = 2;
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     init_info.Allocator = nullptr;
@@ -702,8 +1204,4 @@ void Renderer::CreateUI() {
     init_info.DescriptorPool = uiDescriptorPool;
 
     ImGui_ImplVulkan_Init(&init_info, renderPass);
-
-    // Create UI buffer object
-    uiControlBuffer.MapMemory(device, sizeof(UIControlBufferObject));
-    memcpy(uiControlBuffer.mappedData, &uiControlBufferObject, sizeof(UIControlBufferObject));
 }
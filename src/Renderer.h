@@ -1,11 +1,16 @@
 #pragma once
 
 #include "Device.h"
-#include "SwapChain.h"
+#include "RenderTarget.h"
 #include "Scene.h"
 #include "Camera.h"
 
+#include "GpuProfiler.h"
 #include "Image.h"
+#include "AssetStreamer.h"
+#include "SparseVolume.h"
+#include "VolumeSequencePlayer.h"
+#include "VolumeResidency.h"
 #include "shaderprogram/ShaderProgramIncludes.h"
 
 #include "ImGui/imgui.h"
@@ -26,17 +31,32 @@ struct UIControlBufferObject {
     float godray_exposure = 0.09f;
 
     float sky_turbidity = 12.0f;
+
+    // Not UI controls: world space box and texel extent of the modeling volume on screen
+    glm::vec4 voxel_bound_min = glm::vec4(-1024.0f, -1024.0f, -128.0f, 0.0f);
+    glm::vec4 voxel_bound_max = glm::vec4(1024.0f, 1024.0f, 128.0f, 0.0f);
+    glm::ivec4 voxel_dimension = glm::ivec4(512, 512, 64, 0);
+    // Index space coordinate of texel 0 of the sparse volume, w is 1 while the shaders sample it instead of the textures
+    glm::ivec4 sparse_index_min = glm::ivec4(0);
+    // Byte offset of each channel's NanoVDB grid in the sparse volume buffer
+    glm::uvec4 sparse_grid_offsets = glm::uvec4(0);
 };
 
 class Renderer {
 public:
     Renderer() = delete;
-    Renderer(GLFWwindow* window, Device* device, SwapChain* swapChain, Scene* scene, Camera* camera);
+    // framesInFlight is the number of frames the CPU may record ahead of the GPU, scene and camera need as many buffers.
+    // Without a window the renderer is headless: renderTarget is an OffscreenTarget and there is no UI.
+    Renderer(GLFWwindow* window, Device* device, RenderTarget* renderTarget, Scene* scene, Camera* camera, uint32_t framesInFlight = 2);
     ~Renderer();
 
     void CreateUI();
+    bool HasUI() const { return window != nullptr; }
     ImGuiIO* GetIO() const { return io; }
     bool MouseOverImGuiWindow() const { return mouseOverImGuiWindow; }
+    bool IsStreaming() const { return !assetStreamer->IsIdle(); }
+    GpuProfiler* GetProfiler() const { return profiler; }
+    // Copies the UI state into the buffer of the frame being recorded
     void UpdateUIBuffer();
 
     void CreateCommandPools();
@@ -45,24 +65,86 @@ public:
     // void CreateOffscreenRenderPass();
 
     void CreateModels();
+    void CreateFrameSlots();
+    void DestroyFrameSlots();
     void CreateDescriptors();
     void CreatePipelines();
 
+    // Textures loaded from disk and fixed size targets, created once
+    void CreateStaticResources();
+    void DestroyStaticResources();
+
+    // Targets sized by the swapchain extent, rebuilt on resize
     void CreateFrameResources();
     void DestroyFrameResources();
     void RecreateFrameResources();
+    void UpdateFrameDescriptorSets();
+
+    // Rebinds the volumes the AssetStreamer swapped in
+    void UpdateStreamedDescriptorSets();
+
+    // Points the volume bounds at the modeling volume on screen, the light grid follows its resolution
+    void UpdateVolumeLayout();
+    void ResizeLightGrid(glm::ivec3 dimension);
 
+    // Replaces the modeling volume of both cloud types with a frame numbered sequence ("#" for the number)
+    void PlaySequence(const std::string& pattern, float framesPerSecond = 24.0f);
+    void UpdateSequenceDescriptorSets();
+
+    // Samples the modeling grids of a .vdb file as NanoVDB instead of a dense texture, toggled from the UI
+    void LoadSparseVolume(const std::string& path);
+
+    // Points the descriptor sets the shader programs bind at the uniform buffers of a frame slot
+    void BindFrameDescriptorSets(uint32_t frame);
+
+    // Records the frame slot's graphics commands into the framebuffer of swapchain image index
     void RecordCommandBuffer(uint32_t index);
-    void RecordCommandBuffers();
+    // The post process draw of every slot, only changes with the swapchain
+    void RecordPostCommandBuffers();
+    void RecordUICommandBuffer(uint32_t index);
     // void RecordOffscreenCommandBuffers();
+    // Rerecords the dispatches of every slot in place, nothing may be in flight
     void RecordComputeCommandBuffer();
+    // One buffer per ComputePhase, the queries go to the pools of frame slot frame
+    void RecordComputeCommands(uint32_t frame, VkCommandBuffer* commandBuffers);
 
+    // Advances the CPU side camera, time and UI state, each frame copies it into its own buffers
     void UpdateUniformBuffers();
     void Frame();
 private:
+    // The compute work of a frame is split where it starts writing what the post pass samples. The light grid
+    // and near clouds may run while the graphics queue still draws the previous frame, the far clouds wait for it.
+    enum ComputePhase {
+        LightingPhase,
+        CompositePhase,
+        ComputePhaseCount,
+    };
+
+    // Everything the CPU rewrites or resubmits every frame, one per frame in flight. A slot is only
+    // touched again once its fence, signaled by the slot's graphics submission, has been waited on.
+    struct FrameSlot {
+        VkFence fence;
+        VkSemaphore imageAvailableSemaphore;
+        VkSemaphore renderFinishedSemaphore;
+
+        // Allocated once from pools with resettable buffers, beginning a buffer again resets it.
+        // The primary is recorded every frame and executes the post process draw and the UI.
+        VkCommandBuffer commandBuffer;
+        VkCommandBuffer postCommandBuffer;
+        VkCommandBuffer uiCommandBuffer;
+        // Recorded once against the slot's descriptor sets, like the sequence ones
+        VkCommandBuffer computeCommandBuffers[ComputePhaseCount];
+        VkCommandBuffer sequenceComputeCommandBuffers[VolumeSequencePlayer::TEXTURE_COUNT][ComputePhaseCount];
+
+        UniformBuffer uiControlBuffer;
+        VkDescriptorSet cameraDescriptorSet;
+        VkDescriptorSet sceneDescriptorSet;
+        VkDescriptorSet uiParamDescriptorSet;
+    };
+
     Device* device;
     VkDevice logicalDevice;
-    SwapChain* swapChain;
+    RenderTarget* renderTarget;
     Scene* scene;
     Camera* camera;
 
@@ -106,26 +188,56 @@ private:
     Texture* cloudDetailNoiseTexture;
 
     Texture* lightGridTexture;
+    glm::ivec3 lightGridDimension;
+
+    // Streams the large volumes in behind placeholders after startup
+    AssetStreamer* assetStreamer;
+    // One modeling volume per cloud type, only the selected one has to be resident
+    VolumeResidency* modelingDataResidency;
+    // Animated modeling data, the compute dispatches are recorded once per sequence texture
+    VolumeSequencePlayer* sequencePlayer = nullptr;
+    VkDescriptorSet sequenceDescriptorSets[VolumeSequencePlayer::TEXTURE_COUNT];
+    // NanoVDB modeling data, stands in for both cloud types while useSparseVolume is set
+    SparseVolume* sparseVolume = nullptr;
+    bool useSparseVolume = false;
+    // Bound in its place until one is loaded
+    VkBuffer sparseVolumePlaceholder;
+    Allocation sparseVolumePlaceholderMemory;
+    // Smoothed frame times of the two sampling paths, for comparing them on the same data
+    float denseFrameMilliseconds = 0.0f;
+    float sparseFrameMilliseconds = 0.0f;
 
     // --- Geometries ---
     Model* backgroundQuad;
 
-    // --- Command Buffers ---
-    std::vector<VkCommandBuffer> commandBuffers;
-    // std::vector<VkCommandBuffer> computeCommandBuffers;
-    VkCommandBuffer computeCommandBuffer;
-    // std::vector<VkCommandBuffer> offscreenCommandBuffers;
+    // --- Frames in flight ---
+    std::vector<FrameSlot> frames;
+    uint32_t frameIndex = 0;
+    // Timeline semaphores counting submitted frames, frame n's CompositePhase signals n on the compute one
+    // and its graphics submission n on the graphics one. Frame n + 1's CompositePhase waits for n on the latter.
+    VkSemaphore computeTimelineSemaphore;
+    VkSemaphore graphicsTimelineSemaphore;
+    uint64_t frameNumber = 0;
+
+    // Counts only MemoryAllocator::Allocate calls plus the command buffers allocated through AllocateCommandBuffers.
+    // Fences, semaphores, buffers, descriptor sets and ImGui's own memory are not counted.
+    void AllocateCommandBuffers(VkCommandPool commandPool, VkCommandBufferLevel level, uint32_t count, VkCommandBuffer* commandBuffers);
+    uint64_t commandBufferAllocationCount = 0;
+    uint64_t lastAllocationCount = 0;
+    uint32_t frameAllocationCount = 0;
+
+    // Times every pass of the frame, shown in the control panel
+    GpuProfiler* profiler;
 
     // --- UI ---
     GLFWwindow* window;
-    ImGuiIO* io;
+    ImGuiIO* io = nullptr;
 
     VkDescriptorPool uiDescriptorPool;
 
     bool mouseOverImGuiWindow = false;
 
     UIControlBufferObject uiControlBufferObject;
-    UniformBuffer uiControlBuffer;
 
     bool enableGodray = true;
     bool customSunAngle = false;
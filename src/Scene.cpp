@@ -1,13 +1,18 @@
 #include "Scene.h"
 #include "BufferUtils.h"
+#include "Trace.h"
 
 const float ONE_DAY = 30.0f;
 const float SUN_DISTANCE = 400000.0f;
 
-Scene::Scene(Device* device) : device(device) {
-    BufferUtils::CreateBuffer(device, sizeof(Time), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, timeBuffer, timeBufferMemory);
-    vkMapMemory(device->GetVkDevice(), timeBufferMemory, 0, sizeof(Time), 0, &mappedData);
-    memcpy(mappedData, &time, sizeof(Time));
+Scene::Scene(Device* device, uint32_t frameCount) : device(device) {
+    TRACE_ZONE("Scene::Scene");
+    timeBuffers.resize(frameCount);
+    timeBufferMemories.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; ++i) {
+        BufferUtils::CreateBuffer(device, sizeof(Time), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, timeBuffers[i], timeBufferMemories[i]);
+        UpdateBuffer(i);
+    }
 }
 
 void Scene::UpdateTime(bool controlAngle, float customTheta) {
@@ -25,16 +30,18 @@ void Scene::UpdateTime(bool controlAngle, float customTheta) {
     time.sunPositionY = SUN_DISTANCE * cos(theta) * cos(phi);
     time.sunPositionZ = -SUN_DISTANCE * sin(theta);
     time.sunPositionX = -SUN_DISTANCE * cos(theta) * sin(phi);
-    
-    memcpy(mappedData, &time, sizeof(Time));
 }
 
-VkBuffer Scene::GetTimeBuffer() const {
-    return timeBuffer;
+void Scene::UpdateBuffer(uint32_t frame) {
+    memcpy(timeBufferMemories[frame].mappedData, &time, sizeof(Time));
+}
+
+VkBuffer Scene::GetTimeBuffer(uint32_t frame) const {
+    return timeBuffers[frame];
 }
 
 Scene::~Scene() {
-    vkUnmapMemory(device->GetVkDevice(), timeBufferMemory);
-    vkDestroyBuffer(device->GetVkDevice(), timeBuffer, nullptr);
-    vkFreeMemory(device->GetVkDevice(), timeBufferMemory, nullptr);
+    for (size_t i = 0; i < timeBuffers.size(); ++i) {
+        BufferUtils::DestroyBuffer(device, timeBuffers[i], timeBufferMemories[i]);
+    }
 }
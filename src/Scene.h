@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include <chrono>
+#include <vector>
 
 #include "Model.h"
 
@@ -21,21 +22,23 @@ class Scene {
 private:
     Device* device;
     
-    VkBuffer timeBuffer;
-    VkDeviceMemory timeBufferMemory;
+    // One per frame in flight, UpdateTime only changes time
+    std::vector<VkBuffer> timeBuffers;
+    std::vector<Allocation> timeBufferMemories;
     Time time;
     float theta = 0.0f;
     
-    void* mappedData;
     high_resolution_clock::time_point startTime = high_resolution_clock::now();
 
 public:
     Scene() = delete;
-    Scene(Device* device);
+    Scene(Device* device, uint32_t frameCount = 1);
     ~Scene();
 
-    VkBuffer GetTimeBuffer() const;
+    VkBuffer GetTimeBuffer(uint32_t frame) const;
 
     void UpdateTime(bool controlAngle = false, float customTheta = 0.0f);
+    // Call once the fence of the frame's previous submission has signaled
+    void UpdateBuffer(uint32_t frame);
     float GetTheta() const { return theta * 180.f / PI; }
 };
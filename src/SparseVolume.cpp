@@ -0,0 +1,87 @@
+#include "SparseVolume.h"
+#include "BufferUtils.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "vdb/VoxelConverter.h"
+
+#include <nanovdb/util/CreateNanoGrid.h>
+#include <openvdb/openvdb.h>
+#include <openvdb/tools/ChangeBackground.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+SparseVolume::SparseVolume(Device* device, VkCommandPool commandPool, const std::string& path)
+  : device(device) {
+    TRACE_ZONE("SparseVolume::SparseVolume", path);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    openvdb::initialize();
+    openvdb::io::File file(path);
+    file.open();
+
+    openvdb::GridPtrVec grids(VoxelStore::CHANNEL_COUNT);
+    for (uint32_t c = 0; c < VoxelStore::CHANNEL_COUNT; ++c) {
+        const char* name = VoxelStore::GetChannelName(static_cast<VoxelChannel>(c));
+        if (file.hasGrid(name)) {
+            grids[c] = file.readGrid(name);
+        }
+    }
+    file.close();
+
+    openvdb::CoordBBox bounds = VoxelConverter::EvalActiveBounds(grids);
+    if (bounds.empty()) {
+        throw std::runtime_error("No active modeling voxels in " + path);
+    }
+
+    // Same box and axis order as the texture vdb2nvdf bakes from the file
+    indexMin = glm::ivec3(bounds.min().x(), bounds.min().y(), bounds.min().z());
+    openvdb::Coord extent = bounds.dim();
+    dimension = glm::ivec3(extent.z(), extent.x(), extent.y());
+    VoxelConverter::EvalWorldBounds(grids, bounds, boundsMin, boundsMax);
+
+    // Inactive voxels read as the grid background, which has to be the value the dense path fills in.
+    // A channel without a grid becomes an empty one that only holds its default.
+    std::vector<nanovdb::GridHandle<nanovdb::HostBuffer>> handles(VoxelStore::CHANNEL_COUNT);
+    ThreadPool::Get().ParallelFor(VoxelStore::CHANNEL_COUNT, [&](uint32_t c) {
+        float background = VoxelStore::GetDefault(static_cast<VoxelChannel>(c));
+        openvdb::FloatGrid::Ptr floatGrid;
+        if (grids[c]) {
+            openvdb::FloatGrid::Ptr source = openvdb::gridPtrCast<openvdb::FloatGrid>(grids[c]);
+            if (!source) {
+                throw std::runtime_error(std::string("Sparse volumes need float grids, ") + grids[c]->getName() + " is " + grids[c]->valueType());
+            }
+            floatGrid = source->deepCopy();
+            openvdb::tools::changeBackground(floatGrid->tree(), background);
+        } else {
+            floatGrid = openvdb::FloatGrid::create(background);
+        }
+        handles[c] = nanovdb::createNanoGrid(*floatGrid);
+    });
+
+    std::vector<uint8_t> data;
+    for (uint32_t c = 0; c < VoxelStore::CHANNEL_COUNT; ++c) {
+        // Grids are 32 byte aligned, which keeps every offset a multiple of the uint the shaders read
+        gridOffsets[c] = static_cast<uint32_t>(data.size());
+        data.resize(data.size() + ((handles[c].size() + NANOVDB_DATA_ALIGNMENT - 1) & ~static_cast<uint64_t>(NANOVDB_DATA_ALIGNMENT - 1)));
+        memcpy(data.data() + gridOffsets[c], handles[c].data(), handles[c].size());
+        if (grids[c]) {
+            activeVoxelCount += grids[c]->activeVoxelCount();
+        }
+    }
+    size = data.size();
+
+    BufferUtils::CreateBufferFromData(device, commandPool, data.data(), size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, buffer, memory);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Sparse volume " << path << ": " << activeVoxelCount << " active voxels in " << (size >> 20) << " MB, "
+        << dimension.x << "x" << dimension.y << "x" << dimension.z << " dense texture would be " << (GetDenseSize() >> 20)
+        << " MB, converted in " << elapsed.count() << " ms" << std::endl;
+}
+
+SparseVolume::~SparseVolume() {
+    BufferUtils::DestroyBuffer(device, buffer, memory);
+}
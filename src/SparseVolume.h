@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include "Device.h"
+
+// Modeling data kept as NanoVDB grids in one storage buffer, so its memory follows the active voxels instead of
+// the bounding box a dense texture has to cover. The four modeling grids of a .vdb file are converted on load,
+// the compute shaders sample them through PNanoVDB read accessors (see shaders/sparseVolume.glsl).
+//
+// The layout matches a dense texture baked from the same file by vdb2nvdf, so the two can be switched at runtime.
+class SparseVolume {
+public:
+    // Throws if the file has no modeling voxels or a modeling grid is not a float grid
+    SparseVolume(Device* device, VkCommandPool commandPool, const std::string& path);
+    ~SparseVolume();
+
+    SparseVolume(const SparseVolume&) = delete;
+    SparseVolume& operator=(const SparseVolume&) = delete;
+
+    VkBuffer GetBuffer() const { return buffer; }
+    VkDeviceSize GetSize() const { return size; }
+    // Byte offset of each VoxelChannel's grid in the buffer
+    glm::uvec4 GetGridOffsets() const { return gridOffsets; }
+
+    // Index space coordinate of texel 0 of the equivalent dense texture
+    glm::ivec3 GetIndexMin() const { return indexMin; }
+    // Texel extent of the equivalent dense texture, (index z, index x, index y)
+    glm::ivec3 GetDimension() const { return dimension; }
+    // World space box of the volume, in the same axis order as the dimension
+    glm::vec3 GetBoundsMin() const { return boundsMin; }
+    glm::vec3 GetBoundsMax() const { return boundsMax; }
+
+    uint64_t GetActiveVoxelCount() const { return activeVoxelCount; }
+    // Size of the RGBA8 texture covering the same box
+    VkDeviceSize GetDenseSize() const { return static_cast<VkDeviceSize>(dimension.x) * dimension.y * dimension.z * 4; }
+
+private:
+    Device* device;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation memory;
+    VkDeviceSize size = 0;
+    glm::uvec4 gridOffsets = glm::uvec4(0);
+
+    glm::ivec3 indexMin = glm::ivec3(0);
+    glm::ivec3 dimension = glm::ivec3(0);
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    uint64_t activeVoxelCount = 0;
+};
@@ -68,9 +68,7 @@ SwapChain::SwapChain(Device* device, VkSurfaceKHR vkSurface, unsigned int numBuf
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    if (vkCreateSemaphore(device->GetVkDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-        vkCreateSemaphore(device->GetVkDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS || 
-        vkCreateSemaphore(device->GetVkDevice(), &semaphoreInfo, nullptr, &offscreenFinishedSemaphore) != VK_SUCCESS) {
+    if (vkCreateSemaphore(device->GetVkDevice(), &semaphoreInfo, nullptr, &offscreenFinishedSemaphore) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create semaphores");
     }
 }
@@ -180,14 +178,6 @@ VkImage SwapChain::GetVkImage(uint32_t index) const {
     return vkSwapChainImages[index];
 }
 
-VkSemaphore SwapChain::GetImageAvailableVkSemaphore() const {
-    return imageAvailableSemaphore;
-}
-
-VkSemaphore SwapChain::GetRenderFinishedVkSemaphore() const {
-    return renderFinishedSemaphore;
-}
-
 VkSemaphore SwapChain::GetOffscreenFinishedVkSemaphore() const {
 	return offscreenFinishedSemaphore;
 }
@@ -197,26 +187,23 @@ void SwapChain::Recreate() {
     Create();
 }
 
-bool SwapChain::Acquire() {
-    if (ENABLE_VALIDATION) {
-        // the validation layer implementation expects the application to explicitly synchronize with the GPU
-        vkQueueWaitIdle(device->GetQueue(QueueFlags::Present));
-    }
-    VkResult result = vkAcquireNextImageKHR(device->GetVkDevice(), vkSwapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        throw std::runtime_error("Failed to acquire swap chain image");
-    }
-
+bool SwapChain::Acquire(VkSemaphore imageAvailable) {
+    // No queue wait, the renderer's per frame fences keep the CPU at most a few frames ahead
+    VkResult result = vkAcquireNextImageKHR(device->GetVkDevice(), vkSwapChain, std::numeric_limits<uint64_t>::max(), imageAvailable, VK_NULL_HANDLE, &imageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         Recreate();
         return false;
     }
 
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        throw std::runtime_error("Failed to acquire swap chain image");
+    }
+
     return true;
 }
 
-bool SwapChain::Present() {
-    VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+bool SwapChain::Present(VkSemaphore renderFinished) {
+    VkSemaphore signalSemaphores[] = { renderFinished };
 
     // Submit result back to swap chain for presentation
     VkPresentInfoKHR presentInfo = {};
@@ -232,20 +219,19 @@ bool SwapChain::Present() {
 
     VkResult result = vkQueuePresentKHR(device->GetQueue(QueueFlags::Present), &presentInfo);
 
-    if (result != VK_SUCCESS) {
-        throw std::runtime_error("Failed to present swap chain image");
-    }
-
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
         Recreate();
         return false;
     }
 
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to present swap chain image");
+    }
+
     return true;
 }
 
 SwapChain::~SwapChain() {
-    vkDestroySemaphore(device->GetVkDevice(), imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(device->GetVkDevice(), renderFinishedSemaphore, nullptr);
+    vkDestroySemaphore(device->GetVkDevice(), offscreenFinishedSemaphore, nullptr);
     Destroy();
 }
@@ -2,25 +2,25 @@
 
 #include <vector>
 #include "Device.h"
+#include "RenderTarget.h"
 
 class Device;
-class SwapChain {
+class SwapChain : public RenderTarget {
     friend class Device;
 
 public:
     VkSwapchainKHR GetVkSwapChain() const;
-    VkFormat GetVkImageFormat() const;
-    VkExtent2D GetVkExtent() const;
-    uint32_t GetIndex() const;
-    uint32_t GetCount() const;
-    VkImage GetVkImage(uint32_t index) const;
-    VkSemaphore GetImageAvailableVkSemaphore() const;
-    VkSemaphore GetRenderFinishedVkSemaphore() const;
+    VkFormat GetVkImageFormat() const override;
+    VkExtent2D GetVkExtent() const override;
+    uint32_t GetIndex() const override;
+    uint32_t GetCount() const override;
+    VkImage GetVkImage(uint32_t index) const override;
+    VkImageLayout GetFinalLayout() const override { return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
     VkSemaphore GetOffscreenFinishedVkSemaphore() const;
     
     void Recreate();
-    bool Acquire();
-    bool Present();
+    bool Acquire(VkSemaphore imageAvailable) override;
+    bool Present(VkSemaphore renderFinished) override;
     ~SwapChain();
 
 private:
@@ -37,7 +37,5 @@ private:
     VkExtent2D vkSwapChainExtent;
     uint32_t imageIndex = 0;
 
-    VkSemaphore imageAvailableSemaphore;
     VkSemaphore offscreenFinishedSemaphore;
-    VkSemaphore renderFinishedSemaphore;
 };
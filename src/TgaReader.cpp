@@ -0,0 +1,195 @@
+#include "TgaReader.h"
+#include "MappedFile.h"
+#include "Trace.h"
+
+#include <stb_image.h>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TGA_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define TGA_USE_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace {
+    // BGRA -> RGBA, swaps the first and third byte of every texel
+    void SwizzleBGRA(const uint8_t* src, uint8_t* dst, size_t count) {
+        size_t i = 0;
+#if TGA_USE_SSE2
+        const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+        const __m128i low = _mm_set1_epi32(0xFF);
+        for (; i + 4 <= count; i += 4) {
+            __m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            __m128i red = _mm_and_si128(_mm_srli_epi32(bgra, 16), low);
+            __m128i blue = _mm_slli_epi32(_mm_and_si128(bgra, low), 16);
+            __m128i rgba = _mm_or_si128(_mm_and_si128(bgra, greenAlpha), _mm_or_si128(red, blue));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba);
+        }
+#endif
+        for (; i < count; ++i) {
+            dst[i * 4 + 0] = src[i * 4 + 2];
+            dst[i * 4 + 1] = src[i * 4 + 1];
+            dst[i * 4 + 2] = src[i * 4 + 0];
+            dst[i * 4 + 3] = src[i * 4 + 3];
+        }
+    }
+
+    // BGR -> RGBA with opaque alpha
+    void SwizzleBGR(const uint8_t* src, uint8_t* dst, size_t count) {
+        size_t i = 0;
+#if TGA_USE_SSSE3
+        const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+        // Each load reads 16 bytes for 4 texels (12 bytes), stop early enough to stay inside src
+        for (; i + 6 <= count; i += 4) {
+            __m128i bgr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+            __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba);
+        }
+#endif
+        for (; i < count; ++i) {
+            dst[i * 4 + 0] = src[i * 3 + 2];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 0];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    void Swizzle(const uint8_t* src, uint8_t* dst, size_t count, int bytesPerPixel) {
+        if (bytesPerPixel == 4) {
+            SwizzleBGRA(src, dst, count);
+        } else {
+            SwizzleBGR(src, dst, count);
+        }
+    }
+
+    // Repeats the RGBA texel at dst count times
+    void Fill(uint8_t* dst, size_t count) {
+        uint32_t texel;
+        memcpy(&texel, dst, 4);
+
+        size_t i = 1;
+#if TGA_USE_SSE2
+        const __m128i texels = _mm_set1_epi32(static_cast<int>(texel));
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), texels);
+        }
+#endif
+        for (; i < count; ++i) {
+            memcpy(dst + i * 4, &texel, 4);
+        }
+    }
+
+    void FlipRows(uint8_t* data, int width, int height) {
+        size_t rowSize = static_cast<size_t>(width) * 4;
+        uint8_t* tmp = new uint8_t[rowSize];
+        for (int y = 0; y < height / 2; ++y) {
+            uint8_t* top = data + y * rowSize;
+            uint8_t* bottom = data + (height - 1 - y) * rowSize;
+            memcpy(tmp, top, rowSize);
+            memcpy(top, bottom, rowSize);
+            memcpy(bottom, tmp, rowSize);
+        }
+        delete[] tmp;
+    }
+}
+
+bool Tga::Decode(const uint8_t* data, size_t size, int width, int height, unsigned char* dst) {
+    if (size < 18) {
+        return false;
+    }
+
+    uint8_t idLength = data[0];
+    uint8_t colorMapType = data[1];
+    uint8_t imageType = data[2];
+    int fileWidth = data[12] | (data[13] << 8);
+    int fileHeight = data[14] | (data[15] << 8);
+    uint8_t bitsPerPixel = data[16];
+    uint8_t descriptor = data[17];
+
+    bool rle = imageType == 10;
+    if (colorMapType != 0 || (imageType != 2 && !rle) || (bitsPerPixel != 24 && bitsPerPixel != 32)) {
+        return false;
+    }
+    if (fileWidth != width || fileHeight != height || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    int bytesPerPixel = bitsPerPixel / 8;
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    const uint8_t* src = data + 18 + idLength;
+    const uint8_t* end = data + size;
+    if (src > end) {
+        return false;
+    }
+
+    if (!rle) {
+        if (static_cast<size_t>(end - src) < pixelCount * bytesPerPixel) {
+            return false;
+        }
+        Swizzle(src, dst, pixelCount, bytesPerPixel);
+    } else {
+        // Packets may cross scanlines, the image is decoded as one run of texels
+        size_t written = 0;
+        while (written < pixelCount) {
+            if (src >= end) {
+                return false;
+            }
+            uint8_t header = *src++;
+            size_t count = (header & 0x7F) + 1;
+            if (count > pixelCount - written) {
+                count = pixelCount - written;
+            }
+
+            uint8_t* out = dst + written * 4;
+            if (header & 0x80) {
+                if (end - src < bytesPerPixel) {
+                    return false;
+                }
+                Swizzle(src, out, 1, bytesPerPixel);
+                Fill(out, count);
+                src += bytesPerPixel;
+            } else {
+                if (static_cast<size_t>(end - src) < count * bytesPerPixel) {
+                    return false;
+                }
+                Swizzle(src, out, count, bytesPerPixel);
+                src += count * bytesPerPixel;
+            }
+            written += count;
+        }
+    }
+
+    // Bit 5 set means the first row is the top one, same as stb_image the right-to-left bit is ignored
+    if (!(descriptor & 0x20)) {
+        FlipRows(dst, width, height);
+    }
+    return true;
+}
+
+bool Tga::LoadRGBA(const std::string& path, int width, int height, unsigned char* dst) {
+    MappedFile file;
+    if (file.Open(path) && Tga::Decode(file.GetData(), file.GetSize(), width, height, dst)) {
+        return true;
+    }
+
+    int fileWidth, fileHeight, channels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &fileWidth, &fileHeight, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        return false;
+    }
+
+    Trace::AddFileRead(path);
+
+    bool match = fileWidth == width && fileHeight == height;
+    if (match) {
+        memcpy(dst, pixels, static_cast<size_t>(width) * height * 4);
+    }
+    stbi_image_free(pixels);
+    return match;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Reader for the 8 bit per channel truecolor .tga slices the volumes are stored in
+namespace Tga {
+    // Decodes an uncompressed (type 2) or RLE (type 10) 24/32 bit image of the given size as RGBA8 into dst,
+    // which must hold width * height * 4 bytes. Returns false for any other variant or a truncated file.
+    bool Decode(const uint8_t* data, size_t size, int width, int height, unsigned char* dst);
+
+    // Memory maps path and decodes it straight into dst, anything Decode() does not handle goes through stb_image.
+    // Returns false if the file cannot be loaded or is not width x height.
+    bool LoadRGBA(const std::string& path, int width, int height, unsigned char* dst);
+}
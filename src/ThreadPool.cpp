@@ -0,0 +1,115 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+
+ThreadPool::ThreadPool(unsigned int numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        workers.emplace_back([this, i]() {
+            Trace::SetThreadName("ThreadPool worker " + std::to_string(i));
+            WorkerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::Enqueue(std::function<void()> task) {
+    std::packaged_task<void()> packagedTask(std::move(task));
+    std::future<void> result = packagedTask.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(packagedTask));
+    }
+    condition.notify_one();
+    return result;
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    // Shared between the helpers so a helper that starts after the loop finished does nothing
+    struct State {
+        std::atomic<uint32_t> next{ 0 };
+        std::atomic<uint32_t> done{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    const std::function<void(uint32_t)>* bodyPtr = &body;
+
+    auto run = [state, bodyPtr, count]() {
+        for (uint32_t i = state->next++; i < count; i = state->next++) {
+            try {
+                (*bodyPtr)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+
+            if (++state->done == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    // The calling thread works too, so nested calls from a worker cannot starve
+    uint32_t helpers = std::min(GetThreadCount(), count - 1);
+    for (uint32_t i = 0; i < helpers; ++i) {
+        Enqueue(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state, count]() { return state->done == count; });
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+ThreadPool& ThreadPool::Get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads used for CPU side asset work (slice decoding, conversions)
+class ThreadPool {
+public:
+    // numThreads == 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+    std::future<void> Enqueue(std::function<void()> task);
+
+    // Runs body(i) for every i in [0, count) across the workers and the calling thread.
+    // Blocks until every index has been processed and rethrows the first exception raised by body.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body);
+
+    // Pool shared by the loaders
+    static ThreadPool& Get();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
@@ -0,0 +1,147 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct Event {
+        const char* name;
+        std::string detail;
+        uint32_t threadId;
+        double start; // microseconds since startup
+        double duration;
+        uint64_t bytesRead;
+        uint64_t bytesUploaded;
+    };
+
+    const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+    std::atomic<uint64_t> totalBytesRead{ 0 };
+    std::atomic<uint64_t> totalBytesUploaded{ 0 };
+    std::atomic<uint32_t> nextThreadId{ 1 };
+    std::atomic<bool> recording{ true };
+
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::map<uint32_t, std::string> threadNames;
+
+    uint32_t GetThreadId() {
+        thread_local uint32_t threadId = nextThreadId++;
+        return threadId;
+    }
+
+    double ToMicroseconds(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time - origin).count();
+    }
+
+    void WriteString(FILE* file, const std::string& value) {
+        fputc('"', file);
+        for (char c : value) {
+            switch (c) {
+                case '"': fputs("\\\"", file); break;
+                case '\\': fputs("\\\\", file); break;
+                case '\n': fputs("\\n", file); break;
+                case '\t': fputs("\\t", file); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        fprintf(file, "\\u%04x", c);
+                    } else {
+                        fputc(c, file);
+                    }
+            }
+        }
+        fputc('"', file);
+    }
+}
+
+void Trace::AddBytesRead(uint64_t bytes) {
+    totalBytesRead += bytes;
+}
+
+void Trace::AddFileRead(const std::string& path) {
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (!error) {
+        totalBytesRead += size;
+    }
+}
+
+void Trace::AddBytesUploaded(uint64_t bytes) {
+    totalBytesUploaded += bytes;
+}
+
+void Trace::SetThreadName(const std::string& name) {
+    uint32_t threadId = GetThreadId();
+    std::lock_guard<std::mutex> lock(mutex);
+    threadNames[threadId] = name;
+}
+
+bool Trace::Write(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    recording = false;
+    std::vector<Event> written;
+    written.swap(events);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+    for (const auto& thread : threadNames) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", thread.first);
+        WriteString(file, thread.second);
+        fputs("}}", file);
+        first = false;
+    }
+
+    for (const Event& event : written) {
+        fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+        WriteString(file, event.name);
+        fprintf(file, ",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytesRead\":%llu,\"bytesUploaded\":%llu",
+            event.threadId, event.start, event.duration,
+            static_cast<unsigned long long>(event.bytesRead), static_cast<unsigned long long>(event.bytesUploaded));
+        if (!event.detail.empty()) {
+            fputs(",\"detail\":", file);
+            WriteString(file, event.detail);
+        }
+        fputs("}}", file);
+        first = false;
+    }
+    fputs("\n]}\n", file);
+
+    return fclose(file) == 0;
+}
+
+TraceZone::TraceZone(const char* name, const std::string& detail)
+  : name(name),
+    detail(detail),
+    start(std::chrono::steady_clock::now()),
+    bytesRead(totalBytesRead),
+    bytesUploaded(totalBytesUploaded) {}
+
+TraceZone::~TraceZone() {
+    if (!recording) {
+        return;
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    Event event;
+    event.name = name;
+    event.detail = std::move(detail);
+    event.threadId = GetThreadId();
+    event.start = ToMicroseconds(start);
+    event.duration = ToMicroseconds(end) - event.start;
+    event.bytesRead = totalBytesRead - bytesRead;
+    event.bytesUploaded = totalBytesUploaded - bytesUploaded;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (recording) {
+        events.push_back(std::move(event));
+    }
+}
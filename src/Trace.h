@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped timing zones written out as Chrome trace events, the file loads in chrome://tracing and ui.perfetto.dev.
+// Every zone records its thread, wall time and the bytes read from disk / uploaded to the GPU while it was open
+// (counted across all threads, so concurrent zones overlap).
+namespace Trace {
+    void AddBytesRead(uint64_t bytes);
+    // For files read through a library (stb_image), counts their size on disk
+    void AddFileRead(const std::string& path);
+    void AddBytesUploaded(uint64_t bytes);
+
+    // Shown instead of the numeric thread id
+    void SetThreadName(const std::string& name);
+
+    // Writes every zone closed so far and stops recording, zones closed afterwards are dropped so long
+    // running sessions do not grow the event list forever. Returns false if the file cannot be created.
+    bool Write(const std::string& path);
+}
+
+class TraceZone {
+public:
+    // name must outlive the zone (string literals), detail is copied (e.g. the file being loaded)
+    explicit TraceZone(const char* name, const std::string& detail = std::string());
+    ~TraceZone();
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    std::string detail;
+    std::chrono::steady_clock::time_point start;
+    uint64_t bytesRead;
+    uint64_t bytesUploaded;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(...) TraceZone TRACE_CONCAT(traceZone, __LINE__)(__VA_ARGS__)
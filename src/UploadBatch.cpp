@@ -0,0 +1,162 @@
+#include "UploadBatch.h"
+#include "BufferUtils.h"
+#include "Image.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+UploadBatch::UploadBatch(Device* device, VkCommandPool commandPool, QueueFlags queue)
+  : device(device), commandPool(commandPool), queue(queue) {}
+
+UploadBatch::~UploadBatch() {
+    // The GPU may still read the staging buffers of an async submission
+    if (fence != VK_NULL_HANDLE) {
+        Wait();
+    }
+
+    // Anything still pending was never submitted (e.g. a load threw), just drop it
+    Release();
+}
+
+void* UploadBatch::CreateStagingBuffer(VkDeviceSize size, VkBuffer& buffer) {
+    StagingBuffer staging;
+    VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    BufferUtils::CreateBuffer(device, size, stagingUsage, stagingProperties, staging.buffer, staging.memory);
+    stagingBuffers.push_back(staging);
+    stagingSize += size;
+
+    buffer = staging.buffer;
+    return staging.memory.mappedData;
+}
+
+void UploadBatch::AddStagingBuffer(VkBuffer buffer, const Allocation& memory) {
+    StagingBuffer staging;
+    staging.buffer = buffer;
+    staging.memory = memory;
+    stagingBuffers.push_back(staging);
+    stagingSize += memory.size;
+}
+
+void UploadBatch::TransitionLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
+    Image::RecordTransitionLayout(GetCommandBuffer(), image, format, oldLayout, newLayout);
+}
+
+void UploadBatch::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth) {
+    Image::RecordCopyFromBuffer(GetCommandBuffer(), buffer, image, width, height, depth);
+    ++copyCount;
+}
+
+VkCommandBuffer UploadBatch::GetCommandBuffer() {
+    if (commandBuffer != VK_NULL_HANDLE) {
+        return commandBuffer;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device->GetVkDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate upload command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    return commandBuffer;
+}
+
+void UploadBatch::Submit() {
+    if (commandBuffer == VK_NULL_HANDLE) {
+        Release();
+        return;
+    }
+
+    TRACE_ZONE("UploadBatch::Submit");
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint32_t copies = copyCount;
+    VkDeviceSize staged = stagingSize;
+
+    SubmitAsync();
+    Wait();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Upload batch: " << copies << " copies, " << (staged >> 20) << " MB staged, "
+              << elapsed.count() << " ms" << std::endl;
+}
+
+void UploadBatch::SubmitAsync() {
+    if (fence != VK_NULL_HANDLE) {
+        throw std::runtime_error("Upload batch submitted twice");
+    }
+    if (commandBuffer == VK_NULL_HANDLE) {
+        Release();
+        return;
+    }
+
+    vkEndCommandBuffer(commandBuffer);
+    Trace::AddBytesUploaded(stagingSize);
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device->GetVkDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload fence");
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    if (vkQueueSubmit(device->GetQueue(queue), 1, &submitInfo, fence) != VK_SUCCESS) {
+        vkDestroyFence(device->GetVkDevice(), fence, nullptr);
+        fence = VK_NULL_HANDLE;
+        throw std::runtime_error("Failed to submit upload batch");
+    }
+}
+
+bool UploadBatch::IsComplete() {
+    if (fence == VK_NULL_HANDLE) {
+        return true;
+    }
+    if (vkGetFenceStatus(device->GetVkDevice(), fence) != VK_SUCCESS) {
+        return false;
+    }
+
+    vkDestroyFence(device->GetVkDevice(), fence, nullptr);
+    fence = VK_NULL_HANDLE;
+    Release();
+    return true;
+}
+
+void UploadBatch::Wait() {
+    if (fence == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkWaitForFences(device->GetVkDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
+    IsComplete();
+}
+
+void UploadBatch::Release() {
+    if (commandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(device->GetVkDevice(), commandPool, 1, &commandBuffer);
+        commandBuffer = VK_NULL_HANDLE;
+    }
+
+    // Staging memory goes back to the allocator's host visible pool for the next batch
+    for (StagingBuffer& staging : stagingBuffers) {
+        BufferUtils::DestroyBuffer(device, staging.buffer, staging.memory);
+    }
+    stagingBuffers.clear();
+    stagingSize = 0;
+    copyCount = 0;
+}
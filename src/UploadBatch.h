@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "Device.h"
+
+// Collects the layout transitions and buffer to image copies of a load phase into one command buffer.
+// Submit() runs them with a single fenced submission and releases every staging buffer together.
+// SubmitAsync() returns right away, the staging buffers are released once IsComplete() sees the fence.
+class UploadBatch {
+public:
+    // commandPool must belong to the family of queue
+    UploadBatch(Device* device, VkCommandPool commandPool, QueueFlags queue = QueueFlags::Graphics);
+    ~UploadBatch();
+
+    UploadBatch(const UploadBatch&) = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+
+    Device* GetDevice() const { return device; }
+
+    // Host visible buffer that stays alive until Submit, returns its mapped memory
+    void* CreateStagingBuffer(VkDeviceSize size, VkBuffer& buffer);
+    // Takes ownership of a staging buffer filled elsewhere (e.g. on a worker thread)
+    void AddStagingBuffer(VkBuffer buffer, const Allocation& memory);
+
+    void TransitionLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+    void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth);
+
+    // Begins recording on first use
+    VkCommandBuffer GetCommandBuffer();
+
+    bool IsEmpty() const { return commandBuffer == VK_NULL_HANDLE; }
+
+    // Blocks until the GPU has executed everything recorded so far, does nothing for an empty batch.
+    // The batch can be reused afterwards.
+    void Submit();
+
+    // Non blocking variants: submit, then poll (or wait) for the fence before reusing the batch
+    void SubmitAsync();
+    bool IsComplete();
+    void Wait();
+
+private:
+    struct StagingBuffer {
+        VkBuffer buffer;
+        Allocation memory;
+    };
+
+    void Release();
+
+    Device* device;
+    VkCommandPool commandPool;
+    QueueFlags queue;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE; // only while a submission is in flight
+
+    std::vector<StagingBuffer> stagingBuffers;
+    VkDeviceSize stagingSize = 0;
+    uint32_t copyCount = 0;
+};
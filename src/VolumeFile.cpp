@@ -0,0 +1,118 @@
+#include "VolumeFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    const char MAGIC[4] = { 'N', 'V', 'O', 'L' };
+}
+
+bool VolumeFile::Open(const std::string& path) {
+    Close();
+
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    if (file.GetSize() < sizeof(VolumeHeader)) {
+        file.Close();
+        throw std::runtime_error("Volume file too small: " + path);
+    }
+
+    const VolumeHeader* fileHeader = reinterpret_cast<const VolumeHeader*>(file.GetData());
+    if (memcmp(fileHeader->magic, MAGIC, sizeof(MAGIC)) != 0 || fileHeader->version != VERSION) {
+        file.Close();
+        throw std::runtime_error("Unsupported volume file: " + path);
+    }
+
+    uint64_t expectedSize = static_cast<uint64_t>(fileHeader->width) * fileHeader->height * fileHeader->depth * fileHeader->texelSize;
+    if (fileHeader->dataSize != expectedSize || fileHeader->dataOffset % DATA_ALIGNMENT != 0 ||
+        fileHeader->dataOffset + fileHeader->dataSize > file.GetSize()) {
+        file.Close();
+        throw std::runtime_error("Corrupt volume file: " + path);
+    }
+
+    header = fileHeader;
+    return true;
+}
+
+void VolumeFile::Close() {
+    header = nullptr;
+    file.Close();
+}
+
+bool VolumeFile::VerifyHash() const {
+    return Hash(GetData(), static_cast<size_t>(header->dataSize)) == header->contentHash;
+}
+
+VolumeHeader VolumeFile::MakeHeader(uint32_t width, uint32_t height, uint32_t depth, VkFormat format, uint32_t texelSize, const VolumeChannel channels[4]) {
+    VolumeHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    header.depth = depth;
+    header.format = static_cast<uint32_t>(format);
+    header.texelSize = texelSize;
+    for (int i = 0; i < 4; ++i) {
+        header.channels[i] = channels[i];
+    }
+
+    // Default to the unit cube, callers with world space data overwrite this
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = 0.0f;
+        header.boundsMax[i] = 1.0f;
+    }
+    return header;
+}
+
+void VolumeFile::Write(const std::string& path, VolumeHeader header, const void* data) {
+    header.dataSize = static_cast<uint64_t>(header.width) * header.height * header.depth * header.texelSize;
+    header.dataOffset = (sizeof(VolumeHeader) + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    header.contentHash = Hash(data, static_cast<size_t>(header.dataSize));
+
+    // Written next to the target and renamed over it, readers never see a partially written file
+    std::string tmpPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE* out = fopen(tmpPath.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("Failed to open volume file for writing: " + tmpPath);
+    }
+
+    std::vector<uint8_t> prefix(static_cast<size_t>(header.dataOffset), 0);
+    memcpy(prefix.data(), &header, sizeof(VolumeHeader));
+
+    bool written = fwrite(prefix.data(), 1, prefix.size(), out) == prefix.size() &&
+                   fwrite(data, 1, static_cast<size_t>(header.dataSize), out) == header.dataSize;
+    written = (fclose(out) == 0) && written;
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(tmpPath, path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(tmpPath, error);
+        throw std::runtime_error("Failed to write volume file: " + path);
+    }
+}
+
+std::string VolumeFile::GetPackedPath(const std::string& slicePrefix) {
+    std::string path = slicePrefix;
+    while (!path.empty() && path.back() == ' ') {
+        path.pop_back();
+    }
+    return path + ".pvol";
+}
+
+uint64_t VolumeFile::Hash(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+
+// Meaning of a texel channel in a packed volume
+enum class VolumeChannel : uint8_t {
+    Unused = 0,
+    // Nubis modeling data
+    DimensionalProfile,
+    DetailType,
+    DensityScale,
+    SDF,
+    // Nubis detail noise
+    LowFreqCurlAlligator,
+    HighFreqCurlAlligator,
+    LowFreqAlligator,
+    HighFreqAlligator,
+    // Legacy cloud shape noise
+    PerlinWorley,
+    Worley,
+};
+
+// On-disk header, texels follow at dataOffset (x fastest, then y, then z) ready for vkCmdCopyBufferToImage
+struct VolumeHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t format;        // VkFormat
+    uint32_t texelSize;     // bytes per texel
+    VolumeChannel channels[4];
+    // World space box covered by the volume, in texel axis order: [0] runs along width, [1] along height and
+    // [2] along depth, as the shaders map world xyz straight onto uvw. Baked VDB volumes store index (z, x, y)
+    // as texel (x, y, z) (see VoxelStore), so their bounds are the VDB world box permuted the same way.
+    float boundsMin[3];
+    float boundsMax[3];
+    uint64_t contentHash;   // FNV-1a 64 of the texel data
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+// Packed single-file 3D texture, read through a memory mapping
+class VolumeFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+    // Page aligned, which also satisfies any optimalBufferCopyOffsetAlignment
+    static constexpr uint64_t DATA_ALIGNMENT = 4096;
+
+    // Returns false if the file does not exist, throws if it exists but is not a valid volume
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return header != nullptr; }
+    const VolumeHeader& GetHeader() const { return *header; }
+    VkFormat GetFormat() const { return static_cast<VkFormat>(header->format); }
+    const uint8_t* GetData() const { return file.GetData() + header->dataOffset; }
+
+    // Rehashes the texel data, touches every page of the file
+    bool VerifyHash() const;
+
+    static VolumeHeader MakeHeader(uint32_t width, uint32_t height, uint32_t depth, VkFormat format, uint32_t texelSize, const VolumeChannel channels[4]);
+    // Fills in the hash, data offset and size of header before writing, replaces path atomically
+    static void Write(const std::string& path, VolumeHeader header, const void* data);
+    // "<slice prefix>.pvol", without the separator space some prefixes end with ("hiResClouds ")
+    static std::string GetPackedPath(const std::string& slicePrefix);
+    static uint64_t Hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+private:
+    MappedFile file;
+    const VolumeHeader* header = nullptr;
+};
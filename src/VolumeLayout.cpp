@@ -0,0 +1,17 @@
+#include "VolumeLayout.h"
+
+VolumeLayout VolumeLayout::Make(glm::ivec3 dimension, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+    VolumeLayout layout;
+    layout.dimension = dimension;
+    layout.lightGridDimension = glm::max(dimension / 2, glm::ivec3(1));
+
+    if (glm::all(glm::lessThan(boundsMin, boundsMax))) {
+        layout.boundsMin = boundsMin;
+        layout.boundsMax = boundsMax;
+    } else {
+        glm::vec3 halfExtent = glm::vec3(dimension) * (0.5f * WORLD_UNITS_PER_TEXEL);
+        layout.boundsMin = -halfExtent;
+        layout.boundsMax = halfExtent;
+    }
+    return layout;
+}
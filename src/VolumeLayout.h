@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Placement of the modeling volume the cloud shaders read from voxel_bound_min/max and voxel_dimension.
+// They map world xyz straight onto texture uvw, so bounds and dimension are both in texel axis order.
+struct VolumeLayout {
+    // World scale of volumes whose files carry no bounds, 512x512x64 spans 2048x2048x256 around the origin
+    static constexpr float WORLD_UNITS_PER_TEXEL = 4.0f;
+
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    glm::ivec3 dimension = glm::ivec3(0);
+    // Half the modeling resolution, at least one texel per axis
+    glm::ivec3 lightGridDimension = glm::ivec3(0);
+
+    // Empty bounds center the volume on the origin at WORLD_UNITS_PER_TEXEL
+    static VolumeLayout Make(glm::ivec3 dimension, glm::vec3 boundsMin, glm::vec3 boundsMax);
+};
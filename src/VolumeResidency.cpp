@@ -0,0 +1,122 @@
+#include "VolumeResidency.h"
+#include "AssetStreamer.h"
+
+#include <iostream>
+
+VolumeResidency::VolumeResidency(AssetStreamer* streamer, VkDeviceSize budget)
+  : streamer(streamer), budget(budget) {}
+
+uint32_t VolumeResidency::Add(const std::string& path, glm::ivec3 dimension, Texture** slot, UploadBatch* batch) {
+    streamer->BindPlaceholder(slot, batch);
+
+    Entry entry;
+    entry.path = path;
+    entry.dimension = dimension;
+    entry.slot = slot;
+    entry.size = static_cast<VkDeviceSize>(dimension.x) * dimension.y * dimension.z * 4;
+    entries.push_back(entry);
+    return static_cast<uint32_t>(entries.size() - 1);
+}
+
+void VolumeResidency::SetActive(uint32_t index) {
+    if (index < entries.size()) {
+        // Switching back to a volume that failed tries it once more
+        if (index != active && entries[index].state == State::Failed) {
+            entries[index].state = State::Evicted;
+        }
+        active = index;
+    }
+}
+
+void VolumeResidency::Prefetch(uint32_t index) {
+    if (index < entries.size()) {
+        entries[index].prefetched = true;
+        entries[index].prefetchFrame = frame;
+    }
+}
+
+VkDeviceSize VolumeResidency::GetCommittedBytes() const {
+    VkDeviceSize bytes = 0;
+    for (const Entry& entry : entries) {
+        if (entry.state == State::Loading || entry.state == State::Resident) {
+            bytes += entry.size;
+        }
+    }
+    return bytes;
+}
+
+uint32_t VolumeResidency::GetResidentCount() const {
+    uint32_t count = 0;
+    for (const Entry& entry : entries) {
+        if (entry.state == State::Resident) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void VolumeResidency::Update() {
+    ++frame;
+    if (entries.empty()) {
+        return;
+    }
+
+    for (Entry& entry : entries) {
+        if (entry.state != State::Loading || streamer->IsStreaming(entry.slot)) {
+            continue;
+        }
+        if (streamer->HasFailed(entry.slot)) {
+            entry.state = State::Failed;
+            std::cout << "Could not load " << entry.path << ", keeping its placeholder" << std::endl;
+        } else {
+            entry.state = State::Resident;
+            entry.size = (*entry.slot)->imageMemory.size;
+        }
+    }
+
+    Entry& current = entries[active];
+    current.lastUsedFrame = frame;
+    if (current.state == State::Evicted) {
+        Load(current);
+    }
+
+    // A prefetch may push the total over budget, it is only protected for PREFETCH_GRACE_FRAMES
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].state == State::Evicted && IsProtected(entries[i], i)) {
+            Load(entries[i]);
+        }
+    }
+
+    // Evict the least recently used inactive volumes until the rest fits
+    while (GetCommittedBytes() > budget) {
+        Entry* victim = nullptr;
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            Entry& entry = entries[i];
+            if (entry.state != State::Resident || IsProtected(entry, i)) {
+                continue;
+            }
+            if (!victim || entry.lastUsedFrame < victim->lastUsedFrame) {
+                victim = &entry;
+            }
+        }
+        if (!victim) {
+            break;
+        }
+
+        streamer->Evict(victim->slot);
+        victim->state = State::Evicted;
+        victim->size = static_cast<VkDeviceSize>(victim->dimension.x) * victim->dimension.y * victim->dimension.z * 4;
+        std::cout << "Evicted " << victim->path << ", " << (GetCommittedBytes() >> 20) << " / " << (budget >> 20)
+                  << " MB of volumes resident" << std::endl;
+    }
+}
+
+void VolumeResidency::Load(Entry& entry) {
+    streamer->StreamTexture3D(entry.path, entry.dimension, entry.slot);
+    entry.state = State::Loading;
+    entry.lastUsedFrame = frame;
+}
+
+bool VolumeResidency::IsProtected(const Entry& entry, uint32_t index) const {
+    return index == active || (entry.prefetched && frame - entry.prefetchFrame <= PREFETCH_GRACE_FRAMES);
+}
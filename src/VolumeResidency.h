@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Image.h"
+
+class AssetStreamer;
+
+// Keeps only the volumes that are in use resident out of a catalogue of interchangeable ones
+// (e.g. one modeling volume per cloud type). The active volume is loaded on demand through the
+// AssetStreamer, inactive ones stay around as a cache until they no longer fit in the budget,
+// then the least recently used one is replaced by a placeholder again.
+class VolumeResidency {
+public:
+    // Frames a prefetched volume is protected from eviction without being touched again
+    static constexpr uint32_t PREFETCH_GRACE_FRAMES = 120;
+
+    VolumeResidency(AssetStreamer* streamer, VkDeviceSize budget);
+
+    VolumeResidency(const VolumeResidency&) = delete;
+    VolumeResidency& operator=(const VolumeResidency&) = delete;
+
+    // *slot gets a placeholder (recorded into batch if given), nothing is loaded until the volume is used
+    uint32_t Add(const std::string& path, glm::ivec3 dimension, Texture** slot, UploadBatch* batch = nullptr);
+
+    void SetActive(uint32_t index);
+    // Starts loading a volume that is likely to become active soon (e.g. hovered in the UI)
+    void Prefetch(uint32_t index);
+
+    void SetBudget(VkDeviceSize bytes) { budget = bytes; }
+    VkDeviceSize GetBudget() const { return budget; }
+
+    // Resident volumes plus the ones being streamed in, volumes that failed to load are not counted
+    VkDeviceSize GetCommittedBytes() const;
+    uint32_t GetResidentCount() const;
+
+    // Call once per frame before AssetStreamer::Update(), which performs the loads and evictions
+    void Update();
+
+private:
+    enum class State {
+        Evicted,
+        Loading,
+        Resident,
+        // Streaming failed, keeps its placeholder until the volume is made active again
+        Failed
+    };
+
+    struct Entry {
+        std::string path;
+        glm::ivec3 dimension;
+        Texture** slot;
+        State state = State::Evicted;
+        VkDeviceSize size; // RGBA8 estimate until resident
+        uint64_t lastUsedFrame = 0;
+        uint64_t prefetchFrame = 0;
+        bool prefetched = false;
+    };
+
+    void Load(Entry& entry);
+    bool IsProtected(const Entry& entry, uint32_t index) const;
+
+    AssetStreamer* streamer;
+    VkDeviceSize budget;
+
+    std::vector<Entry> entries;
+    uint32_t active = 0;
+    uint64_t frame = 0;
+};
@@ -0,0 +1,375 @@
+#include "VolumeSequencePlayer.h"
+#include "BufferUtils.h"
+#include "Instance.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "UploadBatch.h"
+#include "VolumeFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    bool EndsWith(const std::string& value, const std::string& suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+VolumeSequencePlayer::VolumeSequencePlayer(Device* device, const std::string& pattern, glm::ivec3 vdbDimension, float framesPerSecond, uint32_t lookahead)
+  : device(device), queue(QueueFlags::Transfer), dimension(vdbDimension), framesPerSecond(glm::max(framesPerSecond, 1.0f)) {
+    TRACE_ZONE("VolumeSequencePlayer::VolumeSequencePlayer", pattern);
+
+    FindFrames(pattern);
+
+    // Packed frames keep their texel format, .vdb frames are quantized to RGBA8 like FromVDBFile
+    uint32_t texelSize = 4;
+    if (EndsWith(framePaths[0], ".pvol")) {
+        VolumeFile volume;
+        if (!volume.Open(framePaths[0])) {
+            throw std::runtime_error("Failed to open " + framePaths[0]);
+        }
+        const VolumeHeader& header = volume.GetHeader();
+        format = volume.GetFormat();
+        texelSize = header.texelSize;
+        dimension = glm::ivec3(header.width, header.height, header.depth);
+        boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    }
+    frameSize = static_cast<VkDeviceSize>(dimension.x) * dimension.y * dimension.z * texelSize;
+
+    // Uploads on the transfer queue like the AssetStreamer, it shares the graphics family
+    const QueueFamilyIndices& indices = device->GetInstance()->GetQueueFamilyIndices();
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = indices[queue];
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(device->GetVkDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool");
+    }
+
+    for (FrameTexture& frameTexture : textures) {
+        Texture* texture = new Texture();
+        Image::Create3D(device,
+            dimension,
+            format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            texture->image,
+            texture->imageMemory);
+        texture->imageView = Image::CreateView(device, texture->image, format, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_3D);
+        texture->sampler = Image::CreateSampler(device);
+        texture->dimension = dimension;
+        texture->boundsMin = boundsMin;
+        texture->boundsMax = boundsMax;
+        frameTexture.texture = texture;
+    }
+
+    // Staging buffers stay mapped for the whole playback, the decode jobs write straight into them
+    VkBufferUsageFlags stagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    VkMemoryPropertyFlags stagingProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < std::max(lookahead, 1u); ++i) {
+        Slot* slot = new Slot();
+        BufferUtils::CreateBuffer(device, frameSize, stagingUsage, stagingProperties, slot->stagingBuffer, slot->stagingMemory);
+        freeSlots.push_back(slot);
+    }
+
+    // The first frame is on screen before playback starts, the back texture only needs a valid layout
+    Slot* slot = freeSlots.back();
+    Decode(slot, framePaths[0]);
+    UploadBatch batch(device, commandPool, queue);
+    RecordUpload(batch, slot, textures[0].texture);
+    batch.TransitionLayout(textures[1].texture->image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    batch.Submit();
+    textures[0].valid = true;
+
+    std::cout << "Playing " << framePaths.size() << " frames of " << pattern << " (" << dimension.x << "x" << dimension.y << "x" << dimension.z
+              << ", " << (frameSize >> 20) << " MB per frame) at " << this->framesPerSecond << " fps" << std::endl;
+
+    nextDecodeFrame = 1 % GetFrameCount();
+    DecodeNext();
+    lastUpdate = std::chrono::high_resolution_clock::now();
+}
+
+VolumeSequencePlayer::~VolumeSequencePlayer() {
+    // Decode jobs write into the staging buffers, let them finish before freeing anything
+    for (Slot* slot : slots) {
+        try {
+            slot->decoded.get();
+        } catch (const std::exception&) {
+        }
+        freeSlots.push_back(slot);
+    }
+    if (upload) {
+        delete upload;
+        freeSlots.push_back(uploadSlot);
+    }
+    for (Slot* slot : freeSlots) {
+        BufferUtils::DestroyBuffer(device, slot->stagingBuffer, slot->stagingMemory);
+        delete slot;
+    }
+
+    VkDevice logicalDevice = device->GetVkDevice();
+    for (FrameTexture& frameTexture : textures) {
+        if (!frameTexture.pendingFences.empty()) {
+            vkWaitForFences(logicalDevice, static_cast<uint32_t>(frameTexture.pendingFences.size()), frameTexture.pendingFences.data(), VK_TRUE, UINT64_MAX);
+        }
+        for (VkFence fence : frameTexture.pendingFences) {
+            vkDestroyFence(logicalDevice, fence, nullptr);
+        }
+        vkDestroySampler(logicalDevice, frameTexture.texture->sampler, nullptr);
+        frameTexture.texture->CleanUp(device);
+        delete frameTexture.texture;
+    }
+    for (VkFence fence : freeFences) {
+        vkDestroyFence(logicalDevice, fence, nullptr);
+    }
+
+    vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+}
+
+void VolumeSequencePlayer::FindFrames(const std::string& pattern) {
+    namespace fs = std::filesystem;
+
+    size_t hashBegin = pattern.find('#');
+    if (hashBegin == std::string::npos) {
+        throw std::runtime_error("Sequence pattern has no '#' frame number: " + pattern);
+    }
+    size_t hashEnd = pattern.find_first_not_of('#', hashBegin);
+    std::string prefix = pattern.substr(0, hashBegin);
+    std::string suffix = hashEnd == std::string::npos ? std::string() : pattern.substr(hashEnd);
+
+    // Resolved here once, so .pvol frames opened directly and .vdb frames read through VDBLoader see the same files
+    fs::path resolvedPrefix = fs::path(PROJECT_DIRECTORY) / prefix;
+
+    // Any number of digits matches, so padded and unpadded numbering both work
+    fs::path directory = resolvedPrefix.parent_path();
+    std::string namePrefix = resolvedPrefix.filename().string();
+    if (prefix.empty() || prefix.back() == '/' || prefix.back() == '\\') {
+        namePrefix.clear();
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> frames;
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory.empty() ? fs::path(".") : directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (!entry.is_regular_file() || name.size() <= namePrefix.size() + suffix.size() ||
+            name.compare(0, namePrefix.size(), namePrefix) != 0 || !EndsWith(name, suffix)) {
+            continue;
+        }
+
+        std::string number = name.substr(namePrefix.size(), name.size() - namePrefix.size() - suffix.size());
+        if (number.find_first_not_of("0123456789") == std::string::npos) {
+            frames.emplace_back(std::stoull(number), entry.path().string());
+        }
+    }
+
+    if (frames.empty()) {
+        throw std::runtime_error("No frames match " + pattern);
+    }
+
+    std::sort(frames.begin(), frames.end());
+    for (const auto& frame : frames) {
+        framePaths.push_back(frame.second);
+    }
+}
+
+bool VolumeSequencePlayer::Update() {
+    if (GetFrameCount() < 2) {
+        return false;
+    }
+
+    frameFence = VK_NULL_HANDLE;
+    for (FrameTexture& frameTexture : textures) {
+        RetireFences(frameTexture);
+    }
+
+    FrameTexture& current = textures[front];
+    FrameTexture& back = textures[1 - front];
+
+    if (upload && upload->IsComplete()) {
+        delete upload;
+        upload = nullptr;
+        back.frame = uploadSlot->frame;
+        back.valid = true;
+        freeSlots.push_back(uploadSlot);
+        uploadSlot = nullptr;
+        DecodeNext();
+    }
+
+    // The head slot always holds the frame after the one on screen, it is copied as soon as
+    // no submission in flight samples the back texture anymore
+    uint32_t nextFrame = (current.frame + 1) % GetFrameCount();
+    bool nextReady = back.valid && back.frame == nextFrame;
+    if (!upload && !nextReady && back.pendingFences.empty() && !slots.empty() &&
+        slots.front()->decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        Slot* slot = slots.front();
+        slots.erase(slots.begin());
+
+        try {
+            slot->decoded.get();
+            decodeMilliseconds += slot->decodeMilliseconds;
+            ++decodedFrames;
+
+            back.valid = false;
+            upload = new UploadBatch(device, commandPool, queue);
+            RecordUpload(*upload, slot, back.texture);
+            upload->SubmitAsync();
+            uploadSlot = slot;
+        } catch (const std::exception& e) {
+            // A broken frame holds the previous one on screen for its duration
+            std::cout << "Failed to decode " << framePaths[slot->frame] << ": " << e.what() << std::endl;
+            current.frame = slot->frame;
+            freeSlots.push_back(slot);
+            DecodeNext();
+        }
+    }
+
+    auto now = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = now - lastUpdate;
+    lastUpdate = now;
+    if (!playing) {
+        return false;
+    }
+
+    double frameDuration = 1.0 / framesPerSecond;
+    frameTime += elapsed.count();
+    if (frameTime < frameDuration) {
+        return false;
+    }
+
+    if (upload || !back.valid || back.frame != nextFrame) {
+        if (!late) {
+            ++lateFrames;
+            late = true;
+        }
+        return false;
+    }
+
+    front = 1 - front;
+    late = false;
+    frameTime -= frameDuration;
+    // Behind by more than a frame (e.g. after a hitch), drop the backlog instead of fast forwarding
+    if (frameTime >= frameDuration) {
+        frameTime = 0.0;
+    }
+    return true;
+}
+
+VkFence VolumeSequencePlayer::AcquireFrameFence() {
+    if (GetFrameCount() < 2) {
+        return VK_NULL_HANDLE;
+    }
+
+    if (frameFence == VK_NULL_HANDLE) {
+        if (freeFences.empty()) {
+            VkFenceCreateInfo fenceInfo = {};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+            VkFence fence;
+            if (vkCreateFence(device->GetVkDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create fence");
+            }
+            freeFences.push_back(fence);
+        }
+
+        frameFence = freeFences.back();
+        freeFences.pop_back();
+        textures[front].pendingFences.push_back(frameFence);
+    }
+    return frameFence;
+}
+
+void VolumeSequencePlayer::SetPlaying(bool play) {
+    if (play && !playing) {
+        // The time spent paused does not count towards the next frame
+        lastUpdate = std::chrono::high_resolution_clock::now();
+    }
+    playing = play;
+}
+
+// Runs on a ThreadPool worker, only touches the slot, the allocator and the files
+void VolumeSequencePlayer::Decode(Slot* slot, const std::string& path) const {
+    TRACE_ZONE("VolumeSequencePlayer::Decode", path);
+    auto start = std::chrono::high_resolution_clock::now();
+    uint8_t* stagingData = static_cast<uint8_t*>(slot->stagingMemory.mappedData);
+
+    if (EndsWith(path, ".vdb")) {
+        if (format != VK_FORMAT_R8G8B8A8_UNORM) {
+            throw std::runtime_error("Sequence format does not match an RGBA8 .vdb frame");
+        }
+
+        VDBLoadOptions options;
+        for (uint32_t c = 0; c < VoxelStore::CHANNEL_COUNT; ++c) {
+            options.gridNames.push_back(VoxelStore::GetChannelName(static_cast<VoxelChannel>(c)));
+        }
+        options.loadTree = false;
+
+        VDBLoader loader;
+        loader.Load(path, options);
+        if (!loader.IsVDBLoaded() || loader.GetPtr()->mVoxels.IsEmpty()) {
+            throw std::runtime_error("No modeling voxels");
+        }
+
+        // Frames of a simulation rarely share their active bounds, every one is resampled to the texture
+        const VoxelStore& voxels = loader.GetPtr()->mVoxels;
+        if (glm::ivec3(voxels.GetDimension()) != dimension) {
+            voxels.Resample(glm::uvec3(dimension)).PackRGBA8(stagingData);
+        } else {
+            voxels.PackRGBA8(stagingData);
+        }
+    } else {
+        VolumeFile volume;
+        if (!volume.Open(path)) {
+            throw std::runtime_error("Failed to open packed volume");
+        }
+
+        const VolumeHeader& header = volume.GetHeader();
+        if (glm::ivec3(header.width, header.height, header.depth) != dimension || volume.GetFormat() != format || header.dataSize != frameSize) {
+            throw std::runtime_error("Dimensions or format do not match the sequence");
+        }
+        memcpy(stagingData, volume.GetData(), static_cast<size_t>(frameSize));
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    slot->decodeMilliseconds = elapsed.count();
+}
+
+void VolumeSequencePlayer::DecodeNext() {
+    while (!freeSlots.empty()) {
+        Slot* slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        slot->frame = nextDecodeFrame;
+        nextDecodeFrame = (nextDecodeFrame + 1) % GetFrameCount();
+        std::string path = framePaths[slot->frame];
+        slot->decoded = ThreadPool::Get().Enqueue([this, slot, path]() { Decode(slot, path); });
+        slots.push_back(slot);
+    }
+}
+
+void VolumeSequencePlayer::RecordUpload(UploadBatch& batch, Slot* slot, Texture* texture) {
+    // Every texel is overwritten, the previous contents can be discarded
+    batch.TransitionLayout(texture->image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    batch.CopyBufferToImage(slot->stagingBuffer, texture->image, dimension.x, dimension.y, dimension.z);
+    batch.TransitionLayout(texture->image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VolumeSequencePlayer::RetireFences(FrameTexture& frameTexture) {
+    VkDevice logicalDevice = device->GetVkDevice();
+    for (auto it = frameTexture.pendingFences.begin(); it != frameTexture.pendingFences.end();) {
+        if (vkGetFenceStatus(logicalDevice, *it) != VK_SUCCESS) {
+            ++it;
+            continue;
+        }
+        vkResetFences(logicalDevice, 1, &*it);
+        freeFences.push_back(*it);
+        it = frameTexture.pendingFences.erase(it);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include "Device.h"
+#include "Image.h"
+
+class UploadBatch;
+
+// Plays a frame numbered sequence of modeling volumes (.pvol or .vdb) back through two textures.
+// Frames ahead of the displayed one are decoded on the ThreadPool into persistent staging buffers and
+// copied into the back texture on the transfer queue while the front one is sampled. At a frame boundary
+// the renderer just submits the command buffer recorded against the other texture, nothing is waited on.
+//
+// The back texture is only overwritten once the fences of every compute submission that sampled it
+// (see AcquireFrameFence) have signaled.
+class VolumeSequencePlayer {
+public:
+    static constexpr uint32_t TEXTURE_COUNT = 2;
+
+    // pattern contains a run of '#' standing for the frame number, e.g. "clouds/storm.####.pvol", and is relative
+    // to the project directory like every other asset path (absolute patterns are used as they are).
+    // A packed first frame sets the extent and world bounds of the sequence, otherwise .vdb frames are
+    // resampled to vdbDimension. The first frame is loaded before returning, throws if the pattern matches no files.
+    VolumeSequencePlayer(Device* device, const std::string& pattern, glm::ivec3 vdbDimension, float framesPerSecond = 24.0f, uint32_t lookahead = 3);
+    ~VolumeSequencePlayer();
+
+    VolumeSequencePlayer(const VolumeSequencePlayer&) = delete;
+    VolumeSequencePlayer& operator=(const VolumeSequencePlayer&) = delete;
+
+    // Call once per frame from the render thread. Returns true when the front texture changed.
+    bool Update();
+
+    // Signaled by the caller's submission that samples GetFrontIndex(), valid until the next Update()
+    VkFence AcquireFrameFence();
+
+    Texture* GetTexture(uint32_t index) const { return textures[index].texture; }
+    uint32_t GetFrontIndex() const { return front; }
+
+    void SetPlaying(bool play);
+    bool IsPlaying() const { return playing; }
+    void SetFramesPerSecond(float fps) { framesPerSecond = glm::max(fps, 1.0f); }
+    float GetFramesPerSecond() const { return framesPerSecond; }
+
+    uint32_t GetFrameCount() const { return static_cast<uint32_t>(framePaths.size()); }
+    // Position in the sequence of the frame on screen
+    uint32_t GetFrame() const { return textures[front].frame; }
+    // Frame boundaries the next frame was not uploaded in time for
+    uint32_t GetLateFrameCount() const { return lateFrames; }
+    double GetAverageDecodeMilliseconds() const { return decodedFrames ? decodeMilliseconds / decodedFrames : 0.0; }
+
+private:
+    struct Slot {
+        uint32_t frame = 0;
+        std::future<void> decoded;
+        double decodeMilliseconds = 0.0;
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        Allocation stagingMemory;
+    };
+
+    struct FrameTexture {
+        Texture* texture = nullptr;
+        uint32_t frame = 0;
+        bool valid = false;
+        // Compute submissions still sampling the texture
+        std::vector<VkFence> pendingFences;
+    };
+
+    void FindFrames(const std::string& pattern);
+    // Runs on a ThreadPool worker, only touches the slot and the files
+    void Decode(Slot* slot, const std::string& path) const;
+    void DecodeNext();
+    void RecordUpload(UploadBatch& batch, Slot* slot, Texture* texture);
+    void RetireFences(FrameTexture& frameTexture);
+
+    Device* device;
+    QueueFlags queue;
+    VkCommandPool commandPool;
+
+    std::vector<std::string> framePaths;
+    glm::ivec3 dimension;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    VkDeviceSize frameSize;
+
+    FrameTexture textures[TEXTURE_COUNT];
+    uint32_t front = 0;
+
+    // Decoding slots in playback order, the head holds the frame after the one on screen
+    std::vector<Slot*> slots;
+    std::vector<Slot*> freeSlots;
+    uint32_t nextDecodeFrame = 0;
+
+    // Copy of the head slot into the back texture
+    UploadBatch* upload = nullptr;
+    Slot* uploadSlot = nullptr;
+
+    std::vector<VkFence> freeFences;
+    VkFence frameFence = VK_NULL_HANDLE;
+
+    bool playing = true;
+    float framesPerSecond;
+    double frameTime = 0.0;
+    std::chrono::high_resolution_clock::time_point lastUpdate;
+    bool late = false;
+    uint32_t lateFrames = 0;
+
+    double decodeMilliseconds = 0.0;
+    uint32_t decodedFrames = 0;
+};
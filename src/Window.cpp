@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "Window.h"
+#include "Trace.h"
 
 namespace {
     GLFWwindow* window = nullptr;
@@ -10,6 +11,8 @@ GLFWwindow* GetGLFWWindow() {
 }
 
 void InitializeWindow(int width, int height, const char* name) {
+    TRACE_ZONE("InitializeWindow");
+
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
         exit(EXIT_FAILURE);
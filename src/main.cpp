@@ -5,6 +5,16 @@
 #include "Camera.h"
 #include "Scene.h"
 #include "Image.h"
+#include "OffscreenTarget.h"
+#include "DerivedDataCache.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
 
 Device* device;
 SwapChain* swapChain;
@@ -115,56 +125,184 @@ namespace {
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
     static constexpr char* applicationName = "Vulkan Cloud Rendering";
-    InitializeWindow(1920, 1080, applicationName);
-
-    unsigned int glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    Instance* instance = new Instance(applicationName, glfwExtensionCount, glfwExtensions);
+    // Swapchain images asked for, also the most frames that may be in flight
+    static constexpr uint32_t swapChainImageCount = 5;
 
-    VkSurfaceKHR surface;
-    if (glfwCreateWindowSurface(instance->GetVkInstance(), GetGLFWWindow(), nullptr, &surface) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create window surface");
+    // --sequence <pattern> [--fps <n>] plays frame numbered modeling volumes, e.g. "storm.####.pvol"
+    // --sparse <file.vdb> samples the file's modeling grids as NanoVDB, switchable against the dense textures
+    // --frames-in-flight <n> lets the CPU record up to n frames ahead of the GPU (default 2, at most 5)
+    // --headless <width>x<height> renders without a window or swapchain, any device with graphics and compute will do
+    // --frames <n> ends a headless run after n frames, counted once streaming is done (default 300)
+    // --capture <prefix> writes every headless frame to <prefix>0000.png, <prefix>0001.png, ... instead of only timing them
+    std::string sequencePattern;
+    float sequenceFps = 24.0f;
+    std::string sparsePath;
+    uint32_t framesInFlight = 2;
+    bool headless = false;
+    VkExtent2D extent = { 1920, 1080 };
+    uint32_t headlessFrames = 300;
+    std::string capturePrefix;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--sequence") == 0) {
+            sequencePattern = argv[++i];
+        } else if (strcmp(argv[i], "--fps") == 0) {
+            if (sscanf(argv[++i], "%f", &sequenceFps) != 1 || !(sequenceFps > 0.0f)) {
+                std::cout << "--fps expects a frame rate above 0, e.g. 24" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sparse") == 0) {
+            sparsePath = argv[++i];
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0) {
+            if (sscanf(argv[++i], "%u", &framesInFlight) != 1 || framesInFlight == 0 || framesInFlight > swapChainImageCount) {
+                std::cout << "--frames-in-flight expects 1 to " << swapChainImageCount << ", e.g. 2" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+            if (sscanf(argv[++i], "%ux%u", &extent.width, &extent.height) != 2 || extent.width == 0 || extent.height == 0) {
+                std::cout << "--headless expects <width>x<height>, e.g. 1280x720" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            if (sscanf(argv[++i], "%u", &headlessFrames) != 1 || headlessFrames == 0) {
+                std::cout << "--frames expects a frame count above 0, e.g. 300" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            capturePrefix = argv[++i];
+        }
     }
 
-    instance->PickPhysicalDevice({ VK_KHR_SWAPCHAIN_EXTENSION_NAME }, QueueFlagBit::GraphicsBit | QueueFlagBit::TransferBit | QueueFlagBit::ComputeBit | QueueFlagBit::PresentBit, surface);
+    // Covers everything up to the first submitted frame, see trace.json
+    Trace::SetThreadName("Main");
+    TraceZone* startupZone = new TraceZone("Startup");
 
+    Instance* instance;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    RenderTarget* renderTarget;
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.tessellationShader = VK_TRUE;
     deviceFeatures.fillModeNonSolid = VK_TRUE;
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
-    device = instance->CreateDevice(QueueFlagBit::GraphicsBit | QueueFlagBit::TransferBit | QueueFlagBit::ComputeBit | QueueFlagBit::PresentBit, deviceFeatures);
+    if (headless) {
+        // No surface, so no present support is asked for
+        instance = new Instance(applicationName);
+        instance->PickPhysicalDevice({}, QueueFlagBit::GraphicsBit | QueueFlagBit::TransferBit | QueueFlagBit::ComputeBit);
+    } else {
+        InitializeWindow(extent.width, extent.height, applicationName);
+
+        unsigned int glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    swapChain = device->CreateSwapChain(surface, 5); // TODO: check numBuffers
+        instance = new Instance(applicationName, glfwExtensionCount, glfwExtensions);
+
+        if (glfwCreateWindowSurface(instance->GetVkInstance(), GetGLFWWindow(), nullptr, &surface) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create window surface");
+        }
+
+        instance->PickPhysicalDevice({ VK_KHR_SWAPCHAIN_EXTENSION_NAME }, QueueFlagBit::GraphicsBit | QueueFlagBit::TransferBit | QueueFlagBit::ComputeBit | QueueFlagBit::PresentBit, surface);
+    }
+
+    // Optional, the GPU profiler reports shader invocations per pass with it
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(instance->GetPhysicalDevice(), &supportedFeatures);
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+    if (headless) {
+        device = instance->CreateDevice(QueueFlagBit::GraphicsBit | QueueFlagBit::TransferBit | QueueFlagBit::ComputeBit, deviceFeatures);
+        renderTarget = new OffscreenTarget(device, extent, capturePrefix);
+    } else {
+        device = instance->CreateDevice(QueueFlagBit::GraphicsBit | QueueFlagBit::TransferBit | QueueFlagBit::ComputeBit | QueueFlagBit::PresentBit, deviceFeatures);
+        swapChain = device->CreateSwapChain(surface, swapChainImageCount); // TODO: check numBuffers
+        renderTarget = swapChain;
+    }
     // the length of the array is equal to the total number of render passes - 1
 
-    camera = new Camera(device, 1920.f / 1080.f);
+    camera = new Camera(device, static_cast<float>(extent.width) / extent.height, framesInFlight);
 
-    Scene* scene = new Scene(device);
-    renderer = new Renderer(GetGLFWWindow(), device, swapChain, scene, camera);
+    Scene* scene = new Scene(device, framesInFlight);
+    renderer = new Renderer(headless ? nullptr : GetGLFWWindow(), device, renderTarget, scene, camera, framesInFlight);
+    if (!sequencePattern.empty()) {
+        try {
+            renderer->PlaySequence(sequencePattern, sequenceFps);
+        } catch (const std::exception& e) {
+            std::cout << "Not playing sequence: " << e.what() << std::endl;
+        }
+    }
+    if (!sparsePath.empty()) {
+        try {
+            renderer->LoadSparseVolume(sparsePath);
+        } catch (const std::exception& e) {
+            std::cout << "Not using sparse volume: " << e.what() << std::endl;
+        }
+    }
 
-    glfwSetWindowSizeCallback(GetGLFWWindow(), resizeCallback);
-    glfwSetKeyCallback(GetGLFWWindow(), keyCallback);
-    glfwSetMouseButtonCallback(GetGLFWWindow(), mouseDownCallback);
-    glfwSetCursorPosCallback(GetGLFWWindow(), mouseMoveCallback);
+    if (!headless) {
+        glfwSetWindowSizeCallback(GetGLFWWindow(), resizeCallback);
+        glfwSetKeyCallback(GetGLFWWindow(), keyCallback);
+        glfwSetMouseButtonCallback(GetGLFWWindow(), mouseDownCallback);
+        glfwSetCursorPosCallback(GetGLFWWindow(), mouseMoveCallback);
+    }
 
-    while (!ShouldQuit()) {
-        glfwPollEvents();
+    bool traceWritten = false;
+    uint32_t timedFrames = 0;
+    std::chrono::steady_clock::time_point timingStart;
+    while (headless ? timedFrames < headlessFrames : !ShouldQuit()) {
+        if (!headless) {
+            glfwPollEvents();
+        }
         renderer->Frame();
         renderer->UpdateUniformBuffers();
+
+        if (startupZone) {
+            delete startupZone;
+            startupZone = nullptr;
+        }
+
+        // Written once the streamed volumes are in too, so the trace shows the time to full quality
+        if (!traceWritten && !renderer->IsStreaming()) {
+            if (Trace::Write("trace.json")) {
+                std::cout << "Wrote startup trace to trace.json" << std::endl;
+            }
+            DerivedDataCache::Get().PrintStats();
+            traceWritten = true;
+            timingStart = std::chrono::steady_clock::now();
+        } else if (traceWritten) {
+            ++timedFrames;
+        }
     }
 
     vkDeviceWaitIdle(device->GetVkDevice());
 
+    if (headless) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - timingStart;
+        std::cout << "Headless " << extent.width << "x" << extent.height << ": " << timedFrames << " frames, "
+            << elapsed.count() / timedFrames << " ms per frame" << std::endl;
+        GpuProfiler* profiler = renderer->GetProfiler();
+        for (uint32_t pass = 0; pass < GpuPassCount && profiler->IsSupported(); ++pass) {
+            GpuProfiler::PassStats stats = profiler->GetStats(static_cast<GpuPass>(pass));
+            if (stats.samples == 0) {
+                continue;
+            }
+            std::cout << "  " << GpuProfiler::GetPassName(static_cast<GpuPass>(pass)) << ": " << stats.averageMilliseconds
+                << " ms avg, " << stats.p95Milliseconds << " ms p95" << std::endl;
+        }
+        if (profiler->IsSupported() && profiler->WriteCsv("gpu_passes.csv")) {
+            std::cout << "Appended GPU pass timings to gpu_passes.csv" << std::endl;
+        }
+    }
+
     delete scene;
     delete camera;
     delete renderer;
-    delete swapChain;
+    delete renderTarget;
     delete device;
     delete instance;
-    DestroyWindow();
+    if (!headless) {
+        DestroyWindow();
+    }
     return 0;
 }
@@ -1,7 +1,7 @@
 #include "ComputeFarShader.h"
 
-ComputeFarShader::ComputeFarShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
-	: ShaderProgram(device, swapchain, renderPass) {
+ComputeFarShader::ComputeFarShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
+	: ShaderProgram(device, renderTarget, renderPass) {
 	CreateShaderProgram();
 }
 
@@ -4,7 +4,7 @@
 
 class ComputeFarShader : public ShaderProgram {
 public:
-	ComputeFarShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ComputeFarShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	~ComputeFarShader() { }
 
 	void CreateShaderProgram() override;
@@ -1,7 +1,7 @@
 #include "ComputeLightGridShader.h"
 
-ComputeLightGridShader::ComputeLightGridShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
-	: ShaderProgram(device, swapchain, renderPass) {
+ComputeLightGridShader::ComputeLightGridShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
+	: ShaderProgram(device, renderTarget, renderPass) {
 	CreateShaderProgram();
 }
 
@@ -5,7 +5,7 @@
 // Shader for raymarching computation
 class ComputeLightGridShader : public ShaderProgram {
 public:
-	ComputeLightGridShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ComputeLightGridShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	~ComputeLightGridShader() { }
 
 	void CreateShaderProgram() override;
@@ -1,7 +1,7 @@
 #include "ComputeNearShader.h"
 
-ComputeNearShader::ComputeNearShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
-	: ShaderProgram(device, swapchain, renderPass) {
+ComputeNearShader::ComputeNearShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
+	: ShaderProgram(device, renderTarget, renderPass) {
 	CreateShaderProgram();
 }
 
@@ -5,7 +5,7 @@
 // Shader for raymarching computation
 class ComputeNearShader : public ShaderProgram {
 public:
-	ComputeNearShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ComputeNearShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	~ComputeNearShader() { }
 
 	void CreateShaderProgram() override;
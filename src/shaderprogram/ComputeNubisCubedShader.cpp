@@ -1,7 +1,7 @@
 #include "ComputeNubisCubedShader.h"
 
-ComputeNubisCubedShader::ComputeNubisCubedShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
-	: ShaderProgram(device, swapchain, renderPass) {
+ComputeNubisCubedShader::ComputeNubisCubedShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
+	: ShaderProgram(device, renderTarget, renderPass) {
 	CreateShaderProgram();
 }
 
@@ -5,7 +5,7 @@
 // Shader for raymarching computation
 class ComputeNubisCubedShader : public ShaderProgram {
 public:
-	ComputeNubisCubedShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ComputeNubisCubedShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	~ComputeNubisCubedShader() { }
 
 	void CreateShaderProgram() override;
@@ -1,7 +1,7 @@
 #include "ComputeShader.h"
 
-ComputeShader::ComputeShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
-	: ShaderProgram(device, swapchain, renderPass) {
+ComputeShader::ComputeShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
+	: ShaderProgram(device, renderTarget, renderPass) {
 	CreateShaderProgram();
 }
 
@@ -5,7 +5,7 @@
 // Shader for raymarching computation
 class ComputeShader : public ShaderProgram {
 public:
-	ComputeShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ComputeShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	~ComputeShader() { }
 
 	void CreateShaderProgram() override;
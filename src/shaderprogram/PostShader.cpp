@@ -1,7 +1,7 @@
 #include "PostShader.h"
 
-PostShader::PostShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass, std::string vertPath, std::string fragPath)
-	: ShaderProgram(device, swapchain, renderPass)
+PostShader::PostShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass, std::string vertPath, std::string fragPath)
+	: ShaderProgram(device, renderTarget, renderPass)
 {
 	shaderFiles.push_back(vertPath);
 	shaderFiles.push_back(fragPath);
@@ -46,13 +46,13 @@ void PostShader::CreateShaderProgram() {
     VkViewport viewport = {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChain->GetVkExtent().width);
-    viewport.height = static_cast<float>(swapChain->GetVkExtent().height);
+    viewport.width = static_cast<float>(renderTarget->GetVkExtent().width);
+    viewport.height = static_cast<float>(renderTarget->GetVkExtent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     VkRect2D scissor = {};
     scissor.offset = { 0, 0 };
-    scissor.extent = swapChain->GetVkExtent();
+    scissor.extent = renderTarget->GetVkExtent();
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
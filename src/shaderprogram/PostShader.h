@@ -4,7 +4,7 @@
 
 class PostShader : public ShaderProgram {
 public:
-	PostShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass, std::string vertPath, std::string fragPath);
+	PostShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass, std::string vertPath, std::string fragPath);
 	~PostShader() { }
 
 	void CreateShaderProgram() override;
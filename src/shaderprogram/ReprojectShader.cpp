@@ -1,7 +1,7 @@
 #include "ReprojectShader.h"
 
-ReprojectShader::ReprojectShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
-	: ShaderProgram(device, swapchain, renderPass) {
+ReprojectShader::ReprojectShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
+	: ShaderProgram(device, renderTarget, renderPass) {
 	swapBuffers = false;
 	CreateShaderProgram();
 }
@@ -4,7 +4,7 @@
 
 class ReprojectShader : public ShaderProgram {
 public:
-	ReprojectShader(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ReprojectShader(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	~ReprojectShader() { }
 
 	void CreateShaderProgram() override;
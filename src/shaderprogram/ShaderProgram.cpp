@@ -1,9 +1,9 @@
 #include "ShaderProgram.h"
 
-ShaderProgram::ShaderProgram(Device* device, SwapChain* swapchain, VkRenderPass* renderPass)
+ShaderProgram::ShaderProgram(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass)
 {
 	this->device = device;
-	this->swapChain = swapchain;
+	this->renderTarget = renderTarget;
 	this->renderPass = renderPass;
 }
 
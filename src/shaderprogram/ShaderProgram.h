@@ -1,13 +1,14 @@
 #pragma once
 
 #include "Device.h"
+#include "RenderTarget.h"
 #include "Vertex.h"
 #include "ShaderModule.h"
 #include "Descriptor.h"
 
 class ShaderProgram {
 public:
-	ShaderProgram(Device* device, SwapChain* swapchain, VkRenderPass* renderPass);
+	ShaderProgram(Device* device, RenderTarget* renderTarget, VkRenderPass* renderPass);
 	virtual ~ShaderProgram() { }
 	void CleanUp();
 
@@ -23,5 +24,5 @@ protected:
 	VkRenderPass* renderPass;
 
 	Device* device;
-	SwapChain* swapChain;
+	RenderTarget* renderTarget;
 };
\ No newline at end of file
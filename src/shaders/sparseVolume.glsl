@@ -0,0 +1,54 @@
+// NanoVDB modeling grids of a SparseVolume, sampled through PNanoVDB read accessors.
+// Included after the uiParam block, SPARSE_VOLUME_SET is the set of the compute nubis cubed images.
+// The shaders only get here while uiParam.sparse_index_min.w is 1.
+
+#define PNANOVDB_GLSL
+
+layout(std430, set = SPARSE_VOLUME_SET, binding = 3) readonly buffer SparseVolumeBuffer {
+    uint pnanovdb_buf_data[];
+};
+
+#include "nanovdb/PNanoVDB.h"
+
+float ReadSparseValue(pnanovdb_buf_t buf, inout pnanovdb_readaccessor_t accessor, ivec3 ijk) {
+    pnanovdb_address_t address = pnanovdb_readaccessor_get_value_address(PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, ijk);
+    return pnanovdb_read_float(buf, address);
+}
+
+// Trilinear like the dense textures. The eight corners mostly share a leaf, the accessor caches it after the first.
+float SampleSparseChannel(uint gridOffset, vec3 indexPosition) {
+    pnanovdb_buf_t buf = pnanovdb_buf_t(0u);
+    pnanovdb_grid_handle_t grid = pnanovdb_grid_handle_t(pnanovdb_address_t(gridOffset));
+    pnanovdb_root_handle_t root = pnanovdb_tree_get_root(buf, pnanovdb_grid_get_tree(buf, grid));
+    pnanovdb_readaccessor_t accessor;
+    pnanovdb_readaccessor_init(accessor, root);
+
+    ivec3 base = ivec3(floor(indexPosition));
+    vec3 t = indexPosition - vec3(base);
+    float c000 = ReadSparseValue(buf, accessor, base);
+    float c100 = ReadSparseValue(buf, accessor, base + ivec3(1, 0, 0));
+    float c010 = ReadSparseValue(buf, accessor, base + ivec3(0, 1, 0));
+    float c110 = ReadSparseValue(buf, accessor, base + ivec3(1, 1, 0));
+    float c001 = ReadSparseValue(buf, accessor, base + ivec3(0, 0, 1));
+    float c101 = ReadSparseValue(buf, accessor, base + ivec3(1, 0, 1));
+    float c011 = ReadSparseValue(buf, accessor, base + ivec3(0, 1, 1));
+    float c111 = ReadSparseValue(buf, accessor, base + ivec3(1, 1, 1));
+    return mix(mix(mix(c000, c100, t.x), mix(c010, c110, t.x), t.y),
+               mix(mix(c001, c101, t.x), mix(c011, c111, t.x), t.y), t.z);
+}
+
+// Index space position of the normalized coordinate the dense textures are sampled at.
+// Texel centers sit on voxels and texel (x, y, z) holds voxel (y, z, x), see VoxelStore.
+vec3 GetSparseIndexPosition(vec3 inSamplePosition) {
+    vec3 texel = inSamplePosition * vec3(uiParam.voxel_dimension.xyz) - 0.5;
+    return vec3(uiParam.sparse_index_min.xyz) + texel.yzx;
+}
+
+// Raw grid values, R: Dimentional Profile, G: Detail Type, B: Density Scale, A: SDF
+vec4 SampleSparseModelingData(vec3 inSamplePosition) {
+    vec3 index_position = GetSparseIndexPosition(inSamplePosition);
+    return vec4(SampleSparseChannel(uiParam.sparse_grid_offsets.x, index_position),
+                SampleSparseChannel(uiParam.sparse_grid_offsets.y, index_position),
+                SampleSparseChannel(uiParam.sparse_grid_offsets.z, index_position),
+                SampleSparseChannel(uiParam.sparse_grid_offsets.w, index_position));
+}
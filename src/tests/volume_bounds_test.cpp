@@ -0,0 +1,99 @@
+// Bakes a non cubic VDB box the way vdb2nvdf does, loads the volume back and checks that the layout the
+// renderer derives from its header gives every texel axis the world extent of the VDB axis stored along it.
+// Every axis of the box differs, so bounds written in another order than the texels fail.
+//
+// Usage:
+//   volume_bounds_test
+
+#include "VolumeFile.h"
+#include "VolumeLayout.h"
+#include "vdb/VoxelConverter.h"
+
+#include <openvdb/openvdb.h>
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    bool Check(bool condition, const std::string& message) {
+        if (!condition) {
+            std::cout << "FAILED: " << message << std::endl;
+        }
+        return condition;
+    }
+
+    std::string ToString(glm::ivec3 v) {
+        return std::to_string(v.x) + "x" + std::to_string(v.y) + "x" + std::to_string(v.z);
+    }
+}
+
+int main() {
+    const double voxelSize = 2.0;
+    const openvdb::Coord indexMin(0, 0, 0);
+    const openvdb::Coord indexMax(63, 7, 31);
+
+    openvdb::initialize();
+    openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create(VoxelStore::GetDefault(VoxelChannel::DensityScale));
+    grid->setTransform(openvdb::math::Transform::createLinearTransform(voxelSize));
+    grid->sparseFill(openvdb::CoordBBox(indexMin, indexMax), 1.0f, true);
+
+    openvdb::GridPtrVec grids(VoxelStore::CHANNEL_COUNT);
+    grids[static_cast<uint32_t>(VoxelChannel::DensityScale)] = grid;
+
+    // Bake, the steps of vdb2nvdf without cropping or resampling
+    openvdb::CoordBBox bounds = VoxelConverter::EvalActiveBounds(grids);
+    VoxelStore voxels;
+    voxels.Allocate(glm::ivec3(bounds.min().x(), bounds.min().y(), bounds.min().z()),
+        glm::ivec3(bounds.max().x(), bounds.max().y(), bounds.max().z()));
+    VoxelConverter::ConvertGrids(grids, voxels);
+
+    glm::uvec3 dimension = voxels.GetDimension();
+    std::vector<uint8_t> texels(voxels.GetVoxelCount() * 4);
+    voxels.PackRGBA8(texels.data());
+
+    const VolumeChannel channels[4] = { VolumeChannel::DimensionalProfile, VolumeChannel::DetailType, VolumeChannel::DensityScale, VolumeChannel::SDF };
+    VolumeHeader header = VolumeFile::MakeHeader(dimension.x, dimension.y, dimension.z, VK_FORMAT_R8G8B8A8_UNORM, 4, channels);
+    glm::vec3 boundsMin, boundsMax;
+    if (!Check(VoxelConverter::EvalWorldBounds(grids, bounds, boundsMin, boundsMax), "no world bounds for the grids")) {
+        return 1;
+    }
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() / "volume_bounds_test.pvol").string();
+    VolumeFile::Write(path, header, texels.data());
+
+    // Load, the header bounds go into the layout as AssetStreamer and VolumeSequencePlayer hand them over
+    VolumeFile volume;
+    if (!Check(volume.Open(path), "cannot open " + path)) {
+        return 1;
+    }
+    const VolumeHeader& loaded = volume.GetHeader();
+    VolumeLayout layout = VolumeLayout::Make(glm::ivec3(loaded.width, loaded.height, loaded.depth),
+        glm::vec3(loaded.boundsMin[0], loaded.boundsMin[1], loaded.boundsMin[2]),
+        glm::vec3(loaded.boundsMax[0], loaded.boundsMax[1], loaded.boundsMax[2]));
+    volume.Close();
+    std::filesystem::remove(path);
+
+    // Texel x runs along index z, y along index x and the depth along index y
+    openvdb::Coord indexExtent = openvdb::CoordBBox(indexMin, indexMax).dim();
+    glm::ivec3 expectedDimension(indexExtent.z(), indexExtent.x(), indexExtent.y());
+    bool passed = Check(layout.dimension == expectedDimension,
+        "dimension " + ToString(layout.dimension) + ", expected " + ToString(expectedDimension));
+
+    // The bounds span the voxel centers, voxelSize apart along every texel axis
+    glm::vec3 extent = layout.boundsMax - layout.boundsMin;
+    for (int i = 0; i < 3; ++i) {
+        float expected = static_cast<float>((layout.dimension[i] - 1) * voxelSize);
+        passed &= Check(std::abs(extent[i] - expected) < 1e-3f,
+            "texel axis " + std::to_string(i) + " spans " + std::to_string(extent[i]) + " world units, expected " + std::to_string(expected));
+    }
+
+    std::cout << (passed ? "Passed" : "Failed") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Compares Tga::LoadRGBA against stb_image on the shipped volume slices and checks both decode the same texels
+//
+// Usage:
+//   tga_bench [iterations]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "TgaReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct SliceSet {
+        std::string prefix;
+        int width;
+        int height;
+        int depth;
+    };
+
+    // Same path as the loader had before: heap allocation, conversion, copy into the destination
+    void LoadStb(const std::string& path, int width, int height, unsigned char* dst) {
+        int w, h, channels;
+        stbi_uc* pixels = stbi_load(path.c_str(), &w, &h, &channels, STBI_rgb_alpha);
+        if (!pixels || w != width || h != height) {
+            throw std::runtime_error("stb_image failed to load " + path);
+        }
+        memcpy(dst, pixels, static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+    }
+
+    void LoadTga(const std::string& path, int width, int height, unsigned char* dst) {
+        if (!Tga::LoadRGBA(path, width, height, dst)) {
+            throw std::runtime_error("Tga::LoadRGBA failed to load " + path);
+        }
+    }
+
+    template <typename Load>
+    double Time(const SliceSet& set, int iterations, std::vector<uint8_t>& texels, Load load) {
+        size_t sliceSize = static_cast<size_t>(set.width) * set.height * 4;
+
+        double best = 1e30;
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < set.depth; ++i) {
+                std::string slicePath = set.prefix + "(" + std::to_string(i) + ").tga";
+                load(slicePath, set.width, set.height, texels.data() + i * sliceSize);
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        int iterations = argc > 1 ? std::stoi(argv[1]) : 5;
+
+        const std::filesystem::path src_dir = std::filesystem::path(PROJECT_DIRECTORY);
+        const std::vector<SliceSet> sets = {
+            { (src_dir / "images/hiResCloudShape/hiResClouds ").string(), 32, 32, 32 },
+            { (src_dir / "images/lowResCloudShape/lowResCloud").string(), 128, 128, 128 },
+            { (src_dir / "images/vdb/example1/tga/modeling_data").string(), 512, 512, 64 },
+            { (src_dir / "images/vdb/example2/tga/modeling_data").string(), 512, 512, 64 },
+            { (src_dir / "images/noise/tga/NubisVoxelCloudNoise").string(), 128, 128, 128 },
+        };
+
+        double stbTotal = 0.0;
+        double tgaTotal = 0.0;
+        for (const SliceSet& set : sets) {
+            size_t volumeSize = static_cast<size_t>(set.width) * set.height * set.depth * 4;
+            std::vector<uint8_t> stbTexels(volumeSize);
+            std::vector<uint8_t> tgaTexels(volumeSize);
+
+            double stbTime = Time(set, iterations, stbTexels, LoadStb);
+            double tgaTime = Time(set, iterations, tgaTexels, LoadTga);
+            if (stbTexels != tgaTexels) {
+                throw std::runtime_error("Decoded texels differ for " + set.prefix);
+            }
+
+            stbTotal += stbTime;
+            tgaTotal += tgaTime;
+            std::cout << std::filesystem::path(set.prefix).filename().string() << " (" << set.width << "x" << set.height << "x" << set.depth
+                      << "): stb " << stbTime << " ms, tga " << tgaTime << " ms, " << stbTime / tgaTime << "x" << std::endl;
+        }
+
+        std::cout << "Total: stb " << stbTotal << " ms, tga " << tgaTotal << " ms, " << stbTotal / tgaTotal << "x" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
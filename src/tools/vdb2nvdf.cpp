@@ -0,0 +1,276 @@
+// Bakes Nubis modeling data .vdb files (dimensional_profile, detail_type, density_scale and sdf grids) into
+// .pvol volumes the renderer uploads without touching OpenVDB
+//
+// Usage:
+//   vdb2nvdf [options] <input.vdb>...
+//     -o <output.pvol>            output path, only with a single input (default: <input>.pvol)
+//     --format rgba8|rgba16f      rgba8 (default) maps each channel's range to unorm, rgba16f keeps the values
+//     --resolution <w> <h> <d>    trilinear resample to w x h x d texels
+//     --crop <x0 y0 z0 x1 y1 z1>  index space box to keep, grids are only read inside it
+//     --generate-sdf              derive the sdf channel from the density even if the file has an sdf grid
+//                                 (always done when it has none)
+//     --scaling                   also time the grid conversion with 1, 2, 4 ... threads up to the hardware count
+
+#include "VolumeFile.h"
+#include "vdb/VoxelConverter.h"
+
+#include <openvdb/openvdb.h>
+#include <tbb/task_arena.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Options {
+        std::string output;
+        bool halfFloat = false;
+        bool resample = false;
+        glm::uvec3 resolution = glm::uvec3(0);
+        bool crop = false;
+        openvdb::CoordBBox cropBox;
+        bool generateSdf = false;
+        bool scaling = false;
+        std::vector<std::string> inputs;
+    };
+
+    class StageTimer {
+    public:
+        void Stage(const char* name) {
+            auto now = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double, std::milli> elapsed = now - start;
+            std::cout << "  " << name << ": " << elapsed.count() << " ms" << std::endl;
+            start = now;
+        }
+
+    private:
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    };
+
+    // Converts the grids again in task arenas of 1, 2, 4 ... threads. Tasks are per grid and per leaf range,
+    // so the speedup shows both the grid level and the leaf level parallelism.
+    void ReportScaling(const openvdb::GridPtrVec& grids, const openvdb::CoordBBox& bounds) {
+        int maxThreads = tbb::this_task_arena::max_concurrency();
+        double baseline = 0.0;
+        for (int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+            VoxelStore voxels;
+            voxels.Allocate(glm::ivec3(bounds.min().x(), bounds.min().y(), bounds.min().z()),
+                glm::ivec3(bounds.max().x(), bounds.max().y(), bounds.max().z()));
+
+            tbb::task_arena arena(threads);
+            auto start = std::chrono::high_resolution_clock::now();
+            arena.execute([&]() { VoxelConverter::ConvertGrids(grids, voxels); });
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            if (threads == 1) {
+                baseline = milliseconds;
+            }
+            std::cout << "  " << threads << " threads: " << milliseconds << " ms, "
+                      << (milliseconds > 0.0 ? baseline / milliseconds : 0.0) << "x" << std::endl;
+
+            if (threads == maxThreads) {
+                break;
+            }
+        }
+    }
+
+    void Bake(const std::string& inputPath, const std::string& outputPath, const Options& options) {
+        std::cout << inputPath << std::endl;
+        auto bakeStart = std::chrono::high_resolution_clock::now();
+        StageTimer timer;
+
+        openvdb::io::File file(inputPath);
+        file.open();
+
+        // Only the modeling grids are read, clipped to the crop box if there is one
+        openvdb::GridPtrVec grids(VoxelStore::CHANNEL_COUNT);
+        uint64_t gridBytes = 0;
+        for (uint32_t c = 0; c < VoxelStore::CHANNEL_COUNT; ++c) {
+            const char* name = VoxelStore::GetChannelName(static_cast<VoxelChannel>(c));
+            if (!file.hasGrid(name)) {
+                std::cout << "  no " << name << " grid, using " << VoxelStore::GetDefault(static_cast<VoxelChannel>(c)) << std::endl;
+                continue;
+            }
+            if (options.crop) {
+                openvdb::GridBase::ConstPtr metadata = file.readGridMetadata(name);
+                grids[c] = file.readGrid(name, metadata->transform().indexToWorld(options.cropBox));
+            } else {
+                grids[c] = file.readGrid(name);
+            }
+            gridBytes += grids[c]->memUsage();
+        }
+        file.close();
+        timer.Stage("read");
+
+        openvdb::CoordBBox bounds = VoxelConverter::EvalActiveBounds(grids);
+        if (options.crop) {
+            bounds.intersect(options.cropBox);
+        }
+        if (bounds.empty()) {
+            throw std::runtime_error("No active modeling voxels in " + inputPath);
+        }
+
+        VoxelStore voxels;
+        voxels.Allocate(glm::ivec3(bounds.min().x(), bounds.min().y(), bounds.min().z()),
+            glm::ivec3(bounds.max().x(), bounds.max().y(), bounds.max().z()));
+
+        auto convertStart = std::chrono::high_resolution_clock::now();
+        std::vector<VoxelConverter::GridConversion> conversions = VoxelConverter::ConvertGrids(grids, voxels);
+        std::chrono::duration<double> convertTime = std::chrono::high_resolution_clock::now() - convertStart;
+        uint64_t voxelCount = 0;
+        for (const VoxelConverter::GridConversion& conversion : conversions) {
+            voxelCount += conversion.voxelCount;
+        }
+        glm::uvec3 dimension = voxels.GetDimension();
+        std::cout << "  " << voxelCount << " active voxels (" << (gridBytes >> 20) << " MB of grids) into "
+                  << dimension.x << "x" << dimension.y << "x" << dimension.z << ", "
+                  << (convertTime.count() > 0.0 ? voxelCount / convertTime.count() / 1.0e6 : 0.0) << " Mvoxels/s" << std::endl;
+        timer.Stage("convert");
+
+        if (options.scaling) {
+            ReportScaling(grids, bounds);
+            timer.Stage("scaling");
+        }
+
+        // Without an sdf grid every texel would read as the cloud surface and the raymarcher could not skip empty space.
+        // Generated before resampling, in the world units the bounds below are written in.
+        const uint32_t sdfChannel = static_cast<uint32_t>(VoxelChannel::SDF);
+        if (options.generateSdf || !grids[sdfChannel]) {
+            float voxelSize = 1.0f;
+            for (const openvdb::GridBase::Ptr& grid : grids) {
+                if (grid) {
+                    openvdb::Vec3d size = grid->transform().voxelSize();
+                    voxelSize = static_cast<float>(std::min(size.x(), std::min(size.y(), size.z())));
+                    break;
+                }
+            }
+            uint64_t occupied = voxels.GenerateSDF(voxelSize);
+            std::cout << "  generated sdf from " << occupied << " occupied voxels, voxel size " << voxelSize << std::endl;
+            timer.Stage("sdf");
+        }
+
+        if (options.resample && options.resolution != dimension) {
+            voxels = voxels.Resample(options.resolution);
+            dimension = voxels.GetDimension();
+            timer.Stage("resample");
+        }
+
+        uint32_t texelSize = options.halfFloat ? 8 : 4;
+        std::vector<uint8_t> texels(voxels.GetVoxelCount() * texelSize);
+        if (options.halfFloat) {
+            voxels.PackRGBA16F(reinterpret_cast<uint16_t*>(texels.data()));
+        } else {
+            voxels.PackRGBA8(texels.data());
+        }
+        timer.Stage("pack");
+
+        const VolumeChannel channels[4] = { VolumeChannel::DimensionalProfile, VolumeChannel::DetailType, VolumeChannel::DensityScale, VolumeChannel::SDF };
+        VkFormat format = options.halfFloat ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
+        VolumeHeader header = VolumeFile::MakeHeader(dimension.x, dimension.y, dimension.z, format, texelSize, channels);
+
+        // World space extent of the baked box, permuted to the texel order of dimension
+        glm::vec3 boundsMin, boundsMax;
+        if (VoxelConverter::EvalWorldBounds(grids, bounds, boundsMin, boundsMax)) {
+            for (int i = 0; i < 3; ++i) {
+                header.boundsMin[i] = boundsMin[i];
+                header.boundsMax[i] = boundsMax[i];
+            }
+        }
+
+        VolumeFile::Write(outputPath, header, texels.data());
+        timer.Stage("write");
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - bakeStart;
+        std::cout << "Baked " << outputPath << " (" << dimension.x << "x" << dimension.y << "x" << dimension.z << ", "
+                  << (texels.size() >> 20) << " MB) in " << elapsed.count() << " ms" << std::endl;
+    }
+
+    std::string GetOutputPath(const std::string& inputPath) {
+        std::string path = inputPath;
+        if (path.size() > 4 && path.compare(path.size() - 4, 4, ".vdb") == 0) {
+            path.resize(path.size() - 4);
+        }
+        return path + ".pvol";
+    }
+
+    void PrintUsage() {
+        std::cout << "Usage: vdb2nvdf [options] <input.vdb>..." << std::endl;
+        std::cout << "  -o <output.pvol>            output path, only with a single input" << std::endl;
+        std::cout << "  --format rgba8|rgba16f      texel format (default rgba8)" << std::endl;
+        std::cout << "  --resolution <w> <h> <d>    resample to w x h x d texels" << std::endl;
+        std::cout << "  --crop <x0 y0 z0 x1 y1 z1>  index space box to keep" << std::endl;
+        std::cout << "  --generate-sdf              derive the sdf from the density even if the file has one" << std::endl;
+        std::cout << "  --scaling                   report conversion time from 1 thread to the hardware count" << std::endl;
+    }
+
+    Options ParseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(std::string("Missing value for ") + argv[i]);
+                }
+                return argv[++i];
+            };
+
+            if (strcmp(argv[i], "-o") == 0) {
+                options.output = next();
+            } else if (strcmp(argv[i], "--format") == 0) {
+                std::string format = next();
+                if (format != "rgba8" && format != "rgba16f") {
+                    throw std::runtime_error("Unknown format: " + format);
+                }
+                options.halfFloat = format == "rgba16f";
+            } else if (strcmp(argv[i], "--resolution") == 0) {
+                options.resample = true;
+                for (int axis = 0; axis < 3; ++axis) {
+                    options.resolution[axis] = static_cast<uint32_t>(std::stoul(next()));
+                }
+            } else if (strcmp(argv[i], "--crop") == 0) {
+                options.crop = true;
+                int values[6];
+                for (int& value : values) {
+                    value = std::stoi(next());
+                }
+                options.cropBox = openvdb::CoordBBox(values[0], values[1], values[2], values[3], values[4], values[5]);
+            } else if (strcmp(argv[i], "--generate-sdf") == 0) {
+                options.generateSdf = true;
+            } else if (strcmp(argv[i], "--scaling") == 0) {
+                options.scaling = true;
+            } else if (argv[i][0] == '-') {
+                throw std::runtime_error(std::string("Unknown option: ") + argv[i]);
+            } else {
+                options.inputs.push_back(argv[i]);
+            }
+        }
+
+        if (!options.output.empty() && options.inputs.size() != 1) {
+            throw std::runtime_error("-o needs exactly one input");
+        }
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        Options options = ParseOptions(argc, argv);
+        if (options.inputs.empty()) {
+            PrintUsage();
+            return 1;
+        }
+
+        openvdb::initialize();
+        for (const std::string& input : options.inputs) {
+            Bake(input, options.output.empty() ? GetOutputPath(input) : options.output, options);
+        }
+        openvdb::uninitialize();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Packs a directory of numbered .tga slices into a single .pvol volume file
+//
+// Usage:
+//   volume_pack <slice prefix> <width> <height> <depth> <modeling|detail-noise|shape> [output.pvol]
+//   volume_pack --all    (packs every volume the renderer loads)
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "TgaReader.h"
+#include "ThreadPool.h"
+#include "VolumeFile.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    struct PackJob {
+        std::string prefix;
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+        std::string preset;
+    };
+
+    void GetPresetChannels(const std::string& preset, VolumeChannel channels[4]) {
+        if (preset == "modeling") {
+            channels[0] = VolumeChannel::DimensionalProfile;
+            channels[1] = VolumeChannel::DetailType;
+            channels[2] = VolumeChannel::DensityScale;
+            channels[3] = VolumeChannel::SDF;
+        } else if (preset == "detail-noise") {
+            channels[0] = VolumeChannel::LowFreqCurlAlligator;
+            channels[1] = VolumeChannel::HighFreqCurlAlligator;
+            channels[2] = VolumeChannel::LowFreqAlligator;
+            channels[3] = VolumeChannel::HighFreqAlligator;
+        } else if (preset == "shape") {
+            channels[0] = VolumeChannel::PerlinWorley;
+            channels[1] = VolumeChannel::Worley;
+            channels[2] = VolumeChannel::Worley;
+            channels[3] = VolumeChannel::Worley;
+        } else {
+            throw std::runtime_error("Unknown channel preset: " + preset);
+        }
+    }
+
+    void Pack(const PackJob& job, const std::string& outputPath) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        size_t sliceSize = static_cast<size_t>(job.width) * job.height * 4;
+        std::vector<uint8_t> texels(sliceSize * job.depth);
+
+        ThreadPool::Get().ParallelFor(job.depth, [&](uint32_t i) {
+            std::string slicePath = job.prefix + "(" + std::to_string(i) + ").tga";
+
+            if (!Tga::LoadRGBA(slicePath, job.width, job.height, texels.data() + i * sliceSize)) {
+                throw std::runtime_error("Failed to load " + std::to_string(job.width) + "x" + std::to_string(job.height) + " texture image " + slicePath);
+            }
+        });
+
+        VolumeChannel channels[4];
+        GetPresetChannels(job.preset, channels);
+        VolumeHeader header = VolumeFile::MakeHeader(job.width, job.height, job.depth, VK_FORMAT_R8G8B8A8_UNORM, 4, channels);
+        VolumeFile::Write(outputPath, header, texels.data());
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Packed " << outputPath << " (" << job.width << "x" << job.height << "x" << job.depth << ") in "
+                  << elapsed.count() << " ms" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc == 2 && strcmp(argv[1], "--all") == 0) {
+            const std::filesystem::path src_dir = std::filesystem::path(PROJECT_DIRECTORY);
+            const std::vector<PackJob> jobs = {
+                { (src_dir / "images/hiResCloudShape/hiResClouds ").string(), 32, 32, 32, "shape" },
+                { (src_dir / "images/lowResCloudShape/lowResCloud").string(), 128, 128, 128, "shape" },
+                { (src_dir / "images/vdb/example1/tga/modeling_data").string(), 512, 512, 64, "modeling" },
+                { (src_dir / "images/vdb/example2/tga/modeling_data").string(), 512, 512, 64, "modeling" },
+                { (src_dir / "images/noise/tga/NubisVoxelCloudNoise").string(), 128, 128, 128, "detail-noise" },
+            };
+
+            for (const PackJob& job : jobs) {
+                Pack(job, VolumeFile::GetPackedPath(job.prefix));
+            }
+            return 0;
+        }
+
+        if (argc != 6 && argc != 7) {
+            std::cout << "Usage: volume_pack <slice prefix> <width> <height> <depth> <modeling|detail-noise|shape> [output.pvol]" << std::endl;
+            std::cout << "       volume_pack --all" << std::endl;
+            return 1;
+        }
+
+        PackJob job = { argv[1],
+                        static_cast<uint32_t>(std::stoul(argv[2])),
+                        static_cast<uint32_t>(std::stoul(argv[3])),
+                        static_cast<uint32_t>(std::stoul(argv[4])),
+                        argv[5] };
+        Pack(job, argc == 7 ? argv[6] : VolumeFile::GetPackedPath(job.prefix));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -75,25 +75,6 @@ struct vDat {
   float temp;
 };
 
-struct VDatAlt 
-{
-    int pointCount;
-    int type;
-
-    float x;
-    float y;
-    float z;
-
-    int raw_x;
-    int raw_y;
-    int raw_z;
-
-    float density_scale = 1;
-    float detail_type = 1;
-    float dimensional_profile = -1;
-    float sdf = 0;
-};
-
 /// @struct BBoxBare
 /// @brief Structure to simply hold min and max values of a bounding box and
 /// nothing else
@@ -1,16 +1,18 @@
 #include "VDBLoader.h"
+#include <chrono>
 #include <iostream>
 #include <filesystem>
 
-void VDBLoader::Load(const std::string filename) 
+void VDBLoader::Load(const std::string filename, const VDBLoadOptions& options) 
 {
     namespace fs = std::filesystem;
+    auto start = std::chrono::high_resolution_clock::now();
 
     const fs::path src_dir = fs::path(PROJECT_DIRECTORY);
     const std::string file = (src_dir / filename).string();
 
     // load the VDB file
-    vdb_ = std::make_unique<VDB>(file);
+    vdb_ = std::make_unique<VDB>(file, options);
 
     // load the basic information from the file
     if (vdb_->loadBasic()) 
@@ -33,4 +35,7 @@ void VDBLoader::Load(const std::string filename)
     }
 
     is_vdb_loaded_ = true;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Loaded " << filename << " in " << elapsed.count() << " ms" << std::endl;
 }
\ No newline at end of file
@@ -14,7 +14,8 @@ public:
     VDB* GetPtr() { return vdb_.get(); }
     bool IsVDBLoaded() const { return is_vdb_loaded_; }
 
-    void Load(const std::string filename);
+    // filename is relative to the project directory
+    void Load(const std::string filename, const VDBLoadOptions& options = VDBLoadOptions());
 
 private:
     std::unique_ptr<VDB> vdb_;
@@ -0,0 +1,78 @@
+#include "VoxelConverter.h"
+
+#include <tbb/task_group.h>
+
+#include <chrono>
+#include <stdexcept>
+
+openvdb::CoordBBox VoxelConverter::EvalActiveBounds(const openvdb::GridPtrVec& grids) {
+    openvdb::CoordBBox bounds;
+    for (const openvdb::GridBase::Ptr& grid : grids) {
+        if (grid) {
+            bounds.expand(grid->evalActiveVoxelBoundingBox());
+        }
+    }
+    return bounds;
+}
+
+bool VoxelConverter::EvalWorldBounds(const openvdb::GridPtrVec& grids, const openvdb::CoordBBox& bounds, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    for (const openvdb::GridBase::Ptr& grid : grids) {
+        if (grid) {
+            openvdb::BBoxd world = grid->transform().indexToWorld(bounds);
+            boundsMin = glm::vec3(world.min().z(), world.min().x(), world.min().y());
+            boundsMax = glm::vec3(world.max().z(), world.max().x(), world.max().y());
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+    struct ConvertVisitor {
+        VoxelChannel channel;
+        VoxelStore& store;
+        uint64_t voxelCount;
+
+        template <typename GridType>
+        void operator()(const GridType& grid) {
+            voxelCount = VoxelConverter::ConvertGrid(grid, channel, store);
+        }
+    };
+}
+
+bool VoxelConverter::Convert(const openvdb::GridBase& grid, VoxelChannel channel, VoxelStore& store, uint64_t& voxelCount) {
+    ConvertVisitor visitor = { channel, store, 0 };
+    if (!VisitScalarGrid(grid, visitor)) {
+        return false;
+    }
+    voxelCount = visitor.voxelCount;
+    return true;
+}
+
+std::vector<VoxelConverter::GridConversion> VoxelConverter::ConvertGrids(const openvdb::GridPtrVec& grids, VoxelStore& store) {
+    if (grids.size() > VoxelStore::CHANNEL_COUNT) {
+        throw std::runtime_error("More grids than voxel store channels");
+    }
+
+    // every task writes its own entry
+    std::vector<GridConversion> conversions(grids.size());
+    tbb::task_group tasks;
+    for (size_t c = 0; c < grids.size(); ++c) {
+        if (!grids[c]) {
+            continue;
+        }
+        const openvdb::GridBase& grid = *grids[c];
+        GridConversion& conversion = conversions[c];
+        VoxelChannel channel = static_cast<VoxelChannel>(c);
+        tasks.run([&grid, &conversion, channel, &store]() {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (!Convert(grid, channel, store, conversion.voxelCount)) {
+                throw std::runtime_error(std::string("Unsupported value type for grid ") + VoxelStore::GetChannelName(channel) + ": " + grid.valueType());
+            }
+            conversion.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        });
+    }
+    // rethrows the first exception of a task
+    tasks.wait();
+    return conversions;
+}
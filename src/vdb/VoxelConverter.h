@@ -0,0 +1,93 @@
+#pragma once
+
+#include <openvdb/openvdb.h>
+#include <openvdb/tree/LeafManager.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "VoxelStore.h"
+
+// Densifies scalar VDB grids into a VoxelStore, shared by the runtime loader and vdb2nvdf
+namespace VoxelConverter {
+    // Union of the active voxels of every grid, empty if there are none
+    openvdb::CoordBBox EvalActiveBounds(const openvdb::GridPtrVec& grids);
+
+    // World space box spanned by the voxels of bounds, through the transform of the first non null grid.
+    // Returned in texel order (index z, x, y) like VoxelStore::GetDimension(), the shaders map world xyz
+    // straight onto texture uvw. Returns false if every grid is null.
+    bool EvalWorldBounds(const openvdb::GridPtrVec& grids, const openvdb::CoordBBox& bounds, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    // Leaves are split across threads with a LeafManager, they cover disjoint voxels so every thread writes
+    // its own part of the store. Active tiles above the leaf level are filled over their whole extent.
+    // Returns the number of active voxels.
+    template <typename GridType>
+    uint64_t ConvertGrid(const GridType& grid, VoxelChannel channel, VoxelStore& store) {
+        typedef typename GridType::TreeType TreeType;
+        typedef typename TreeType::LeafNodeType LeafType;
+
+        const TreeType& tree = grid.tree();
+        openvdb::tree::LeafManager<const TreeType> leafManager(tree);
+        leafManager.foreach([channel, &store](const LeafType& leaf, size_t) {
+            int x, y, z;
+            for (typename LeafType::ValueOnCIter it = leaf.cbeginValueOn(); it; ++it) {
+                it.getCoord().asXYZ(x, y, z);
+                store.Set(channel, x, y, z, static_cast<float>(*it));
+            }
+        });
+
+        uint64_t voxelCount = tree.activeLeafVoxelCount();
+        typename GridType::ValueOnCIter tileIt = grid.cbeginValueOn();
+        tileIt.setMaxDepth(GridType::ValueOnCIter::LEAF_DEPTH - 1);
+        for (; tileIt; ++tileIt) {
+            openvdb::CoordBBox bbox;
+            tileIt.getBoundingBox(bbox);
+            store.Fill(channel, glm::ivec3(bbox.min().x(), bbox.min().y(), bbox.min().z()),
+                glm::ivec3(bbox.max().x(), bbox.max().y(), bbox.max().z()), static_cast<float>(*tileIt));
+            voxelCount += bbox.volume();
+        }
+        return voxelCount;
+    }
+
+    template <typename GridType, typename Visitor>
+    void VisitAs(const openvdb::GridBase& grid, Visitor& visitor) {
+        visitor(static_cast<const GridType&>(grid));
+    }
+
+    // Calls visitor(const GridType&) with grid cast to its concrete scalar type. The type is resolved with one
+    // lookup of grid.type() in a table built on first use, returns false for vector and string grids.
+    template <typename Visitor>
+    bool VisitScalarGrid(const openvdb::GridBase& grid, Visitor& visitor) {
+        typedef void (*VisitFunction)(const openvdb::GridBase&, Visitor&);
+        static const std::unordered_map<std::string, VisitFunction> table = {
+            { openvdb::FloatGrid::gridType(), &VisitAs<openvdb::FloatGrid, Visitor> },
+            { openvdb::DoubleGrid::gridType(), &VisitAs<openvdb::DoubleGrid, Visitor> },
+            { openvdb::Int32Grid::gridType(), &VisitAs<openvdb::Int32Grid, Visitor> },
+            { openvdb::Int64Grid::gridType(), &VisitAs<openvdb::Int64Grid, Visitor> },
+            { openvdb::BoolGrid::gridType(), &VisitAs<openvdb::BoolGrid, Visitor> },
+            { openvdb::MaskGrid::gridType(), &VisitAs<openvdb::MaskGrid, Visitor> },
+        };
+
+        auto it = table.find(grid.type());
+        if (it == table.end()) {
+            return false;
+        }
+        it->second(grid, visitor);
+        return true;
+    }
+
+    // Dispatches on the value type of grid, returns false for vector and string grids
+    bool Convert(const openvdb::GridBase& grid, VoxelChannel channel, VoxelStore& store, uint64_t& voxelCount);
+
+    struct GridConversion {
+        uint64_t voxelCount = 0;
+        double milliseconds = 0.0;
+    };
+
+    // Converts grids[c] into channel c for every non null grid, the grids run as concurrent tasks of a
+    // tbb::task_group next to the leaf level parallelism of ConvertGrid. Channels are separate arrays so the
+    // tasks never write the same memory. Honours the concurrency of the calling tbb::task_arena.
+    // Throws for grids Convert does not support, returns one entry per grid.
+    std::vector<GridConversion> ConvertGrids(const openvdb::GridPtrVec& grids, VoxelStore& store);
+}
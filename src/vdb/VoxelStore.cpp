@@ -0,0 +1,385 @@
+#include "VoxelStore.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VOXEL_STORE_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const char* CHANNEL_NAMES[VoxelStore::CHANNEL_COUNT] = {
+        "dimensional_profile",
+        "detail_type",
+        "density_scale",
+        "sdf",
+    };
+
+    // Inactive voxels used to read as these, the packed textures depend on it
+    const float CHANNEL_DEFAULTS[VoxelStore::CHANNEL_COUNT] = { -1.0f, 1.0f, 1.0f, 0.0f };
+
+    // Must match the decode in computeNubisCubed.comp, the SDF is remapped from 0..1 to -256..4096
+    const VoxelRange CHANNEL_RANGES[VoxelStore::CHANNEL_COUNT] = {
+        { 0.0f, 1.0f },
+        { 0.0f, 1.0f },
+        { 0.0f, 1.0f },
+        { -256.0f, 4096.0f },
+    };
+
+    uint8_t Quantize(float value, float scale, float bias) {
+        // Written so NaN ends up as 0, same as the SSE2 path
+        float mapped = value * scale + bias;
+        mapped = mapped > 0.0f ? mapped : 0.0f;
+        mapped = mapped < 255.0f ? mapped : 255.0f;
+        return static_cast<uint8_t>(std::lrint(mapped));
+    }
+
+#if VOXEL_STORE_USE_SSE2
+    // Four halves (in the low 16 bits of each lane) to floats, denormals, infinities and NaNs included
+    __m128 HalfToFloat(__m128i halves) {
+        const __m128i noSign = _mm_set1_epi32(0x7fff);
+        const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+        const __m128i maxFinite = _mm_set1_epi32(0x7bff);
+        const __m128 infNanExponent = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+        __m128i exponentMantissa = _mm_and_si128(halves, noSign);
+        __m128i sign = _mm_slli_epi32(_mm_xor_si128(halves, exponentMantissa), 16);
+        // Shifted into float position and rebiased by the multiply, which also normalizes denormals
+        __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)), magic);
+        __m128 infNan = _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(exponentMantissa, maxFinite)), infNanExponent);
+        return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infNan));
+    }
+
+    // Range maps four texels of one channel to 32 bit integers in 0..255
+    __m128i QuantizeChannel(const uint16_t* src, __m128 scale, __m128 bias) {
+        __m128i halves = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)), _mm_setzero_si128());
+        __m128 mapped = _mm_add_ps(_mm_mul_ps(HalfToFloat(halves), scale), bias);
+        mapped = _mm_min_ps(_mm_max_ps(mapped, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+        return _mm_cvtps_epi32(mapped);
+    }
+#endif
+
+    // Squared distance of empty cells, large enough to lose every comparison without overflowing the arithmetic
+    const float EDT_FAR = 1.0e20f;
+
+    // Felzenszwalb and Huttenlocher's lower envelope of parabolas, d[q] = min over p of (q - p)^2 + f[p] in O(n).
+    // v and z are scratch space for n and n + 1 entries.
+    void DistanceTransform1D(const float* f, uint32_t n, float* d, uint32_t* v, float* z) {
+        auto intersect = [f](uint32_t q, uint32_t p) {
+            return ((f[q] + static_cast<float>(q) * q) - (f[p] + static_cast<float>(p) * p)) / (2.0f * q - 2.0f * p);
+        };
+
+        uint32_t k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<float>::infinity();
+        z[1] = std::numeric_limits<float>::infinity();
+        for (uint32_t q = 1; q < n; ++q) {
+            float s = intersect(q, v[k]);
+            while (s <= z[k]) {
+                --k;
+                s = intersect(q, v[k]);
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = std::numeric_limits<float>::infinity();
+        }
+
+        k = 0;
+        for (uint32_t q = 0; q < n; ++q) {
+            while (z[k + 1] < q) {
+                ++k;
+            }
+            float offset = static_cast<float>(q) - static_cast<float>(v[k]);
+            d[q] = offset * offset + f[v[k]];
+        }
+    }
+
+    // Exact squared Euclidean distance transform of grid in place, one separable pass per axis.
+    // Lines of a pass are independent, every thread works through whole slices (or rows for z).
+    void DistanceTransform(std::vector<float>& grid, glm::uvec3 dimension) {
+        const size_t strides[3] = { 1, dimension.x, static_cast<size_t>(dimension.x) * dimension.y };
+
+        for (int axis = 0; axis < 3; ++axis) {
+            uint32_t n = dimension[axis];
+            // The outer loop runs over z for the x and y passes and over y for the z pass
+            uint32_t outerAxis = axis == 2 ? 1 : 2;
+            uint32_t innerAxis = axis == 0 ? 1 : 0;
+
+            ThreadPool::Get().ParallelFor(dimension[outerAxis], [&](uint32_t outer) {
+                std::vector<float> f(n);
+                std::vector<float> d(n);
+                std::vector<uint32_t> v(n);
+                std::vector<float> z(n + 1);
+
+                for (uint32_t inner = 0; inner < dimension[innerAxis]; ++inner) {
+                    float* line = grid.data() + outer * strides[outerAxis] + inner * strides[innerAxis];
+                    bool uniform = true;
+                    for (uint32_t i = 0; i < n; ++i) {
+                        f[i] = line[i * strides[axis]];
+                        uniform = uniform && f[i] == f[0];
+                    }
+                    // Lines entirely inside or outside (most of them in the first pass) are already final
+                    if (uniform && (f[0] == 0.0f || f[0] == EDT_FAR)) {
+                        continue;
+                    }
+                    DistanceTransform1D(f.data(), n, d.data(), v.data(), z.data());
+                    for (uint32_t i = 0; i < n; ++i) {
+                        line[i * strides[axis]] = d[i];
+                    }
+                }
+            });
+        }
+    }
+}
+
+float VoxelStore::GetDefault(VoxelChannel channel) {
+    return CHANNEL_DEFAULTS[static_cast<uint32_t>(channel)];
+}
+
+VoxelRange VoxelStore::GetRange(VoxelChannel channel) {
+    return CHANNEL_RANGES[static_cast<uint32_t>(channel)];
+}
+
+const char* VoxelStore::GetChannelName(VoxelChannel channel) {
+    return CHANNEL_NAMES[static_cast<uint32_t>(channel)];
+}
+
+bool VoxelStore::FindChannel(const std::string& gridName, VoxelChannel& channel) {
+    for (uint32_t i = 0; i < CHANNEL_COUNT; ++i) {
+        if (gridName == CHANNEL_NAMES[i]) {
+            channel = static_cast<VoxelChannel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void VoxelStore::Allocate(glm::ivec3 min, glm::ivec3 max) {
+    if (glm::any(glm::lessThan(max, min))) {
+        throw std::runtime_error("Empty voxel store bounds");
+    }
+
+    this->min = min;
+    dimension = glm::uvec3(max.z - min.z + 1, max.x - min.x + 1, max.y - min.y + 1);
+    for (uint32_t i = 0; i < CHANNEL_COUNT; ++i) {
+        channels[i].assign(GetVoxelCount(), glm::packHalf1x16(CHANNEL_DEFAULTS[i]));
+    }
+}
+
+void VoxelStore::Clear() {
+    min = glm::ivec3(0);
+    dimension = glm::uvec3(0);
+    for (uint32_t i = 0; i < CHANNEL_COUNT; ++i) {
+        channels[i].clear();
+        channels[i].shrink_to_fit();
+    }
+}
+
+void VoxelStore::Fill(VoxelChannel channel, glm::ivec3 min, glm::ivec3 max, float value) {
+    // Texture space box, see GetIndex()
+    glm::ivec3 first = glm::max(glm::ivec3(min.z, min.x, min.y) - glm::ivec3(this->min.z, this->min.x, this->min.y), glm::ivec3(0));
+    glm::ivec3 last = glm::min(glm::ivec3(max.z, max.x, max.y) - glm::ivec3(this->min.z, this->min.x, this->min.y), glm::ivec3(dimension) - 1);
+    if (glm::any(glm::lessThan(last, first))) {
+        return;
+    }
+
+    uint16_t* dst = channels[static_cast<uint32_t>(channel)].data();
+    uint16_t half = glm::packHalf1x16(value);
+    for (int z = first.z; z <= last.z; ++z) {
+        for (int y = first.y; y <= last.y; ++y) {
+            size_t offset = (static_cast<size_t>(z) * dimension.y + y) * dimension.x;
+            std::fill(dst + offset + first.x, dst + offset + last.x + 1, half);
+        }
+    }
+}
+
+float VoxelStore::Get(VoxelChannel channel, int x, int y, int z) const {
+    size_t index;
+    if (!GetIndex(x, y, z, index)) {
+        return GetDefault(channel);
+    }
+    return glm::unpackHalf1x16(channels[static_cast<uint32_t>(channel)][index]);
+}
+
+const uint16_t* VoxelStore::GetSlice(VoxelChannel channel, uint32_t depth) const {
+    if (depth >= dimension.z) {
+        throw std::runtime_error("Voxel store slice out of range");
+    }
+    return channels[static_cast<uint32_t>(channel)].data() + static_cast<size_t>(depth) * dimension.x * dimension.y;
+}
+
+void VoxelStore::CopyBrick(VoxelChannel channel, glm::uvec3 origin, glm::uvec3 size, uint16_t* dst) const {
+    if (glm::any(glm::greaterThan(origin + size, dimension))) {
+        throw std::runtime_error("Voxel store brick out of range");
+    }
+
+    const uint16_t* src = channels[static_cast<uint32_t>(channel)].data();
+    for (uint32_t z = 0; z < size.z; ++z) {
+        for (uint32_t y = 0; y < size.y; ++y) {
+            size_t offset = (static_cast<size_t>(origin.z + z) * dimension.y + origin.y + y) * dimension.x + origin.x;
+            memcpy(dst, src + offset, size.x * sizeof(uint16_t));
+            dst += size.x;
+        }
+    }
+}
+
+void VoxelStore::PackSliceRGBA8(uint32_t depth, uint8_t* dst) const {
+    const uint16_t* slices[CHANNEL_COUNT];
+    float scales[CHANNEL_COUNT];
+    float biases[CHANNEL_COUNT];
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+        slices[c] = GetSlice(static_cast<VoxelChannel>(c), depth);
+        VoxelRange range = CHANNEL_RANGES[c];
+        scales[c] = 255.0f / (range.max - range.min);
+        biases[c] = -range.min * scales[c];
+    }
+
+    size_t texelCount = static_cast<size_t>(dimension.x) * dimension.y;
+    size_t i = 0;
+#if VOXEL_STORE_USE_SSE2
+    __m128 scale[CHANNEL_COUNT];
+    __m128 bias[CHANNEL_COUNT];
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+        scale[c] = _mm_set1_ps(scales[c]);
+        bias[c] = _mm_set1_ps(biases[c]);
+    }
+
+    for (; i + 4 <= texelCount; i += 4) {
+        __m128i r = QuantizeChannel(slices[0] + i, scale[0], bias[0]);
+        __m128i g = QuantizeChannel(slices[1] + i, scale[1], bias[1]);
+        __m128i b = QuantizeChannel(slices[2] + i, scale[2], bias[2]);
+        __m128i a = QuantizeChannel(slices[3] + i, scale[3], bias[3]);
+
+        // r0..r3 g0..g3 b0..b3 a0..a3, then transposed to r0 g0 b0 a0 r1 ...
+        __m128i planar = _mm_packus_epi16(_mm_packs_epi32(r, g), _mm_packs_epi32(b, a));
+        __m128i rg = _mm_unpacklo_epi8(planar, _mm_srli_si128(planar, 4));
+        __m128i ba = _mm_unpacklo_epi8(_mm_srli_si128(planar, 8), _mm_srli_si128(planar, 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_unpacklo_epi16(rg, ba));
+    }
+#endif
+    for (; i < texelCount; ++i) {
+        for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+            dst[i * 4 + c] = Quantize(glm::unpackHalf1x16(slices[c][i]), scales[c], biases[c]);
+        }
+    }
+}
+
+void VoxelStore::PackSliceRGBA16F(uint32_t depth, uint16_t* dst) const {
+    const uint16_t* slices[CHANNEL_COUNT];
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+        slices[c] = GetSlice(static_cast<VoxelChannel>(c), depth);
+    }
+
+    size_t texelCount = static_cast<size_t>(dimension.x) * dimension.y;
+    for (size_t i = 0; i < texelCount; ++i) {
+        for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+            dst[i * 4 + c] = slices[c][i];
+        }
+    }
+}
+
+void VoxelStore::PackRGBA8(uint8_t* dst) const {
+    size_t sliceSize = static_cast<size_t>(dimension.x) * dimension.y * 4;
+    ThreadPool::Get().ParallelFor(dimension.z, [&](uint32_t z) {
+        PackSliceRGBA8(z, dst + z * sliceSize);
+    });
+}
+
+void VoxelStore::PackRGBA16F(uint16_t* dst) const {
+    size_t sliceSize = static_cast<size_t>(dimension.x) * dimension.y * 4;
+    ThreadPool::Get().ParallelFor(dimension.z, [&](uint32_t z) {
+        PackSliceRGBA16F(z, dst + z * sliceSize);
+    });
+}
+
+VoxelStore VoxelStore::Resample(glm::uvec3 newDimension) const {
+    if (glm::any(glm::equal(newDimension, glm::uvec3(0)))) {
+        throw std::runtime_error("Empty voxel store resolution");
+    }
+
+    VoxelStore result;
+    result.min = min;
+    result.dimension = newDimension;
+    glm::vec3 scale = glm::vec3(dimension) / glm::vec3(newDimension);
+    glm::ivec3 last = glm::ivec3(dimension) - 1;
+
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+        const std::vector<uint16_t>& src = channels[c];
+        std::vector<uint16_t>& dst = result.channels[c];
+        dst.resize(result.GetVoxelCount());
+
+        ThreadPool::Get().ParallelFor(newDimension.z, [&](uint32_t z) {
+            auto sample = [&](int x, int y, int z) {
+                return glm::unpackHalf1x16(src[(static_cast<size_t>(z) * dimension.y + y) * dimension.x + x]);
+            };
+
+            for (uint32_t y = 0; y < newDimension.y; ++y) {
+                for (uint32_t x = 0; x < newDimension.x; ++x) {
+                    glm::vec3 position = glm::clamp((glm::vec3(x, y, z) + 0.5f) * scale - 0.5f, glm::vec3(0.0f), glm::vec3(last));
+                    glm::ivec3 p0 = glm::ivec3(position);
+                    glm::ivec3 p1 = glm::min(p0 + 1, last);
+                    glm::vec3 t = position - glm::vec3(p0);
+
+                    float c00 = glm::mix(sample(p0.x, p0.y, p0.z), sample(p1.x, p0.y, p0.z), t.x);
+                    float c10 = glm::mix(sample(p0.x, p1.y, p0.z), sample(p1.x, p1.y, p0.z), t.x);
+                    float c01 = glm::mix(sample(p0.x, p0.y, p1.z), sample(p1.x, p0.y, p1.z), t.x);
+                    float c11 = glm::mix(sample(p0.x, p1.y, p1.z), sample(p1.x, p1.y, p1.z), t.x);
+                    float value = glm::mix(glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+                    dst[(static_cast<size_t>(z) * newDimension.y + y) * newDimension.x + x] = glm::packHalf1x16(value);
+                }
+            }
+        });
+    }
+    return result;
+}
+
+uint64_t VoxelStore::GenerateSDF(float voxelSize) {
+    size_t voxelCount = GetVoxelCount();
+    if (voxelCount == 0) {
+        return 0;
+    }
+
+    const std::vector<uint16_t>& profile = channels[static_cast<uint32_t>(VoxelChannel::DimensionalProfile)];
+    const std::vector<uint16_t>& densityScale = channels[static_cast<uint32_t>(VoxelChannel::DensityScale)];
+    std::vector<uint16_t>& sdf = channels[static_cast<uint32_t>(VoxelChannel::SDF)];
+    size_t sliceSize = static_cast<size_t>(dimension.x) * dimension.y;
+
+    // Distance to the nearest occupied voxel for empty ones and to the nearest empty voxel for occupied ones
+    std::vector<float> outside(voxelCount);
+    std::vector<float> inside(voxelCount);
+    std::vector<uint64_t> occupiedPerSlice(dimension.z, 0);
+    ThreadPool::Get().ParallelFor(dimension.z, [&](uint32_t z) {
+        for (size_t i = z * sliceSize; i < (z + 1) * sliceSize; ++i) {
+            // Same test as the raymarcher, which only takes density where the profile is positive
+            bool occupied = glm::unpackHalf1x16(profile[i]) > 0.0f && glm::unpackHalf1x16(densityScale[i]) > 0.0f;
+            outside[i] = occupied ? 0.0f : EDT_FAR;
+            inside[i] = occupied ? EDT_FAR : 0.0f;
+            occupiedPerSlice[z] += occupied ? 1 : 0;
+        }
+    });
+
+    DistanceTransform(outside, dimension);
+    DistanceTransform(inside, dimension);
+
+    // Conservative: the surface is taken a whole voxel closer than the nearest occupied center, so trilinear
+    // filtering between an empty and an occupied voxel never steps over the cloud, and half a voxel inside
+    VoxelRange range = GetRange(VoxelChannel::SDF);
+    ThreadPool::Get().ParallelFor(dimension.z, [&](uint32_t z) {
+        for (size_t i = z * sliceSize; i < (z + 1) * sliceSize; ++i) {
+            float distance = outside[i] > 0.0f ? std::sqrt(outside[i]) - 1.0f : 0.5f - std::sqrt(inside[i]);
+            sdf[i] = glm::packHalf1x16(glm::clamp(distance * voxelSize, range.min, range.max));
+        }
+    });
+
+    uint64_t occupiedCount = 0;
+    for (uint64_t count : occupiedPerSlice) {
+        occupiedCount += count;
+    }
+    return occupiedCount;
+}
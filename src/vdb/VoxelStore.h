@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Nubis modeling data grids, in the order they are packed into the RGBA texture
+enum class VoxelChannel : uint32_t {
+    DimensionalProfile = 0,
+    DetailType,
+    DensityScale,
+    SDF,
+};
+
+struct VoxelRange {
+    float min;
+    float max;
+};
+
+// Dense structure-of-arrays copy of the modeling data grids, one contiguous half float array per channel
+// covering the active bounding box of the file (8 bytes per voxel instead of a 56 byte VDatAlt).
+//
+// Voxels are addressed by their VDB index space coordinate. VDB y is up and becomes the texture's depth,
+// so index (x, y, z) is stored at texel (z, x, y) and every texture slice is one contiguous run per channel.
+class VoxelStore {
+public:
+    static constexpr uint32_t CHANNEL_COUNT = 4;
+
+    // Value of voxels that are inactive in the grid
+    static float GetDefault(VoxelChannel channel);
+    // Values stored as 0 and 255 in RGBA8 textures, the shaders undo the mapping (see GetVoxelCloudModelingData)
+    static VoxelRange GetRange(VoxelChannel channel);
+    // Name of the grid the channel is read from ("density_scale", ...)
+    static const char* GetChannelName(VoxelChannel channel);
+    // Maps a grid name ("density_scale", ...) to its channel, false for grids the renderer does not use
+    static bool FindChannel(const std::string& gridName, VoxelChannel& channel);
+
+    // Covers the index space box min..max (inclusive), every channel starts out at its default
+    void Allocate(glm::ivec3 min, glm::ivec3 max);
+    void Clear();
+
+    bool IsEmpty() const { return GetVoxelCount() == 0; }
+    // Texture extent in texels, (index z, index x, index y)
+    glm::uvec3 GetDimension() const { return dimension; }
+    glm::ivec3 GetMin() const { return min; }
+    size_t GetVoxelCount() const { return static_cast<size_t>(dimension.x) * dimension.y * dimension.z; }
+    size_t GetMemorySize() const { return GetVoxelCount() * CHANNEL_COUNT * sizeof(uint16_t); }
+
+    // Voxels outside the allocated box are ignored
+    void Set(VoxelChannel channel, int x, int y, int z, float value) {
+        size_t index;
+        if (GetIndex(x, y, z, index)) {
+            channels[static_cast<uint32_t>(channel)][index] = glm::packHalf1x16(value);
+        }
+    }
+    // Sets the index space box min..max (inclusive, e.g. an active tile) clipped to the allocated box
+    void Fill(VoxelChannel channel, glm::ivec3 min, glm::ivec3 max, float value);
+    float Get(VoxelChannel channel, int x, int y, int z) const;
+
+    // Half float texels of texture slice depth (index y = min.y + depth), dimension.x * dimension.y, x fastest
+    const uint16_t* GetSlice(VoxelChannel channel, uint32_t depth) const;
+    // Copies the texture space box origin..origin + size into dst, x fastest
+    void CopyBrick(VoxelChannel channel, glm::uvec3 origin, glm::uvec3 size, uint16_t* dst) const;
+
+    // Interleave texture slice depth into dst (dimension.x * dimension.y texels), channels in VoxelChannel order.
+    // RGBA8 maps every channel's GetRange() onto 0..255, rounded to nearest and clamped.
+    void PackSliceRGBA8(uint32_t depth, uint8_t* dst) const;
+    void PackSliceRGBA16F(uint32_t depth, uint16_t* dst) const;
+    // Every slice in one pass split across the thread pool, dst holds GetVoxelCount() texels
+    void PackRGBA8(uint8_t* dst) const;
+    void PackRGBA16F(uint16_t* dst) const;
+
+    // Trilinear resample of every channel to a new texture extent, texel centers map onto texel centers
+    VoxelStore Resample(glm::uvec3 newDimension) const;
+
+    // Replaces the SDF channel with a signed distance (in world units, voxelSize per voxel) to the voxels the
+    // raymarcher takes density from, for modeling data without an sdf grid. Uses an exact Euclidean distance
+    // transform split across the thread pool, returns the number of occupied voxels.
+    uint64_t GenerateSDF(float voxelSize);
+
+private:
+    bool GetIndex(int x, int y, int z, size_t& index) const {
+        glm::ivec3 texel(z - min.z, x - min.x, y - min.y);
+        if (texel.x < 0 || texel.y < 0 || texel.z < 0 ||
+            static_cast<uint32_t>(texel.x) >= dimension.x || static_cast<uint32_t>(texel.y) >= dimension.y || static_cast<uint32_t>(texel.z) >= dimension.z) {
+            return false;
+        }
+        index = (static_cast<size_t>(texel.z) * dimension.y + texel.y) * dimension.x + texel.x;
+        return true;
+    }
+
+    glm::ivec3 min = glm::ivec3(0);
+    glm::uvec3 dimension = glm::uvec3(0);
+    std::vector<uint16_t> channels[CHANNEL_COUNT];
+};
@@ -19,9 +19,11 @@
 
 #include <openvdb/tools/VolumeToMesh.h>
 
+#include <chrono>
 #include <typeinfo>
 
 #include "Utilities.h"
+#include "VoxelConverter.h"
 #include "math.h"
 
 
@@ -39,13 +41,13 @@ VDB::VDB() {
     initParams();
 }
 
-VDB::VDB(std::string _file) {
+VDB::VDB(std::string _file, const VDBLoadOptions& _options) {
     // init paramaters for the class
     initParams();
     // init openvdb
     init();
     // open file
-    openFile(_file);
+    openFile(_file, _options);
 }
 
 VDB::~VDB() {
@@ -98,16 +100,37 @@ void VDB::init() {
     }
 }
 
-void VDB::openFile(std::string _file) {
+void VDB::openFile(std::string _file, const VDBLoadOptions& _options) {
     openvdb::io::File vdbFile(_file);  // openvdb::file type
     m_fileName = _file;
+    m_options = _options;
     vdbFile.open();
     if (vdbFile.isOpen()) {
         std::cout << "VDB file " << _file << " opened successfully..." << std::endl;
         m_fileOpened = true;
 
         // now load in data to pointers from file
-        m_grid = vdbFile.getGrids();
+        if (_options.gridNames.empty() && !_options.clip) {
+            m_grid = vdbFile.getGrids();
+        }
+        else {
+            // read only the requested grids, and only the part of them inside the clip bounds
+            std::vector<std::string> names = _options.gridNames;
+            if (names.empty()) {
+                for (openvdb::io::File::NameIterator it = vdbFile.beginName(); it != vdbFile.endName(); ++it) {
+                    names.push_back(it.gridName());
+                }
+            }
+
+            m_grid = openvdb::GridPtrVecPtr(new openvdb::GridPtrVec);
+            for (const std::string& name : names) {
+                if (!vdbFile.hasGrid(name)) {
+                    std::cerr << "Grid " << name << " not found in file" << std::endl;
+                    continue;
+                }
+                m_grid->push_back(_options.clip ? vdbFile.readGrid(name, _options.worldBounds) : vdbFile.readGrid(name));
+            }
+        }
         if (!m_grid->empty()) {
             std::cout << "Grids found in file" << std::endl;
             m_allG.resize(0);
@@ -217,7 +240,7 @@ bool VDB::loadBasic() {
         return false;
     }
 
-    if (!loadVDBTree())  // next load in the VDB tree
+    if (m_options.loadTree && !loadVDBTree())  // next load in the VDB tree
     {
         std::cerr << "Failed to load VDB Tree" << std::endl;
         return false;
@@ -299,11 +322,6 @@ int VDB::getNumPointsAtGrid(int _grid) {
     return -1;
 }
 
-const std::vector<openvdb::Vec4f>& VDB::getChannelDataForTexture()
-{
-    return *m_channelValueData;
-}
-
 // TODO : Very Imp! Drawing of VDB Happening Here
 void VDB::drawVDB() {
     // TODO
@@ -576,30 +594,6 @@ void VDB::initParams() {
     for (int i = 0; i < 4; i++) {
         m_drawTreeLevels[i] = 1;
     }
-
-    //initialize data points
-    int xdim = 512;
-    int ydim = 512;
-    int zdim = 64;
-    for (int i = 0; i < xdim; i++) 
-    {
-        for (int j = 0; j < ydim; j++) 
-        {
-            for (int k = 0; k < zdim; k++) 
-            {
-                VDatAlt data;
-                data.raw_x = i;
-                data.raw_y = k;
-                data.raw_z = j;
-                mDataPoints.push_back(data);
-            }
-        }
-    }
-    dimension.x = xdim;
-    dimension.y = ydim;
-    dimension.z = zdim;
-    std::cout << "data initialized: " << mDataPoints.size() << std::endl;
-    // ----------------------------
 }
 
 void VDB::resetParams() {
@@ -611,80 +605,6 @@ void VDB::resetParams() {
     m_loaded = false;
 }
 
-template <typename GridType>
-void VDB::getMeshValuesScalar(typename GridType::ConstPtr _grid) 
-{
-    typedef typename GridType::ValueType ValueType;
-    typedef typename GridType::TreeType TreeType;
-
-    const TreeType& tree = _grid->tree();
-    openvdb::tree::ValueAccessor<const TreeType> acc(tree);  // accesoor into the file of the correct type
-
-    int count = 0;
-
-    // create Vec4 ready for data for texture buffer
-    openvdb::Vec4f channelTemp;
-    channelTemp[3] = 1.0f;
-
-    openvdb::Coord coord;  // coord to get from file
-
-    for (typename GridType::ValueOnCIter it = _grid->cbeginValueOn(); it; ++it) 
-    {
-        coord = it.getCoord();        // retirve coordinate
-        ValueType val = acc.getValue(coord);  // get vector value (colour)
-        openvdb::Vec3d worldSpace = _grid->indexToWorld(coord);  // convert coordinate into world space
-                                              
-        int x, y, z;
-        coord.asXYZ(x, y, z);
-        VDatAlt& data = mDataPoints[x * 512 * 64 + z * 64 + y];
-        data.x = worldSpace[0];
-        data.y = worldSpace[1];
-        data.z = worldSpace[2];
-        data.pointCount = count;
-        
-        count++;  // incremenet point count
-
-        if (channelName(pointChannel()) == "density_scale") 
-        {
-            data.density_scale = (float)val;
-            m_densityScaleData.push_back((float)val);
-        }
-        else if (channelName(pointChannel()) == "detail_type") 
-        {
-            data.detail_type = (float)val;
-            m_detailTypeData.push_back((float)val);
-        }
-        else if (channelName(pointChannel()) == "dimensional_profile") 
-        {
-            data.dimensional_profile = (float)val;
-            m_dimensionalProfileData.push_back((float)val);
-        }
-        else if (channelName(pointChannel()) == "sdf") 
-        {
-            data.sdf = (float)val;
-            m_sdfData.push_back((float)val);
-        }
-
-        data.type = 0; // type scalar
-
-        channelTemp[0] = val;  // store value for texture buffer
-        channelTemp[1] = val;
-        channelTemp[2] = val;
-        m_channelValueData->push_back(channelTemp);  // add to texture store
-        m_tboSize++;
-    }
-}
-
-// TODO
-// logic of this function taken from studying The GL viewer provided with the
-// OpenVDB library this function is idnetical to the one above except it handles
-// vector types so has a few differences which are hihglighted
-template <typename GridType>
-void VDB::getMeshValuesVector(typename GridType::ConstPtr _grid)
-{
-    std::cout << "entered!" << std::endl;
-}
-
 // TODO : Some Stuff
 // get the data values for the VDB tree
 template <typename GridType>
@@ -877,11 +797,26 @@ bool VDB::loadMesh() {
     pBegin = m_grid->begin();
     pEnd = m_grid->end();
 
+    // size the dense store to the union of the active voxels of all grids
+    openvdb::CoordBBox activeBounds = VoxelConverter::EvalActiveBounds(*m_grid);
+    if (m_options.clip && !m_grid->empty()) {
+        // clipped reads keep whole nodes, trim the store to the requested region
+        activeBounds.intersect(m_grid->front()->transform().worldToIndexCellCentered(m_options.worldBounds));
+    }
+    if (activeBounds.empty()) {
+        std::cerr << "No active voxels found in file!!" << std::endl;
+        return false;
+    }
+    mVoxels.Allocate(glm::ivec3(activeBounds.min().x(), activeBounds.min().y(), activeBounds.min().z()),
+        glm::ivec3(activeBounds.max().x(), activeBounds.max().y(), activeBounds.max().z()));
+    std::cout << "Voxel store " << mVoxels.GetDimension().x << "x" << mVoxels.GetDimension().y << "x" << mVoxels.GetDimension().z
+        << " (" << (mVoxels.GetMemorySize() >> 20) << " MB)" << std::endl;
+
+    // the modeling grids by channel, the other grids are not used by the renderer
+    openvdb::GridPtrVec channelGrids(VoxelStore::CHANNEL_COUNT);
+
     m_channel = 0;
     setPointChannel(m_channel);
-    // TODO
-    m_channelValueData = new std::vector<openvdb::Vec4f>;
-    m_channelValueData->resize(0);
 
     while (pBegin != pEnd) {
         if ((*pBegin)) {
@@ -894,16 +829,23 @@ bool VDB::loadMesh() {
             }
 
             m_s.push_back(float((m_numPoints.at(m_channel)) / (numLoadedPoints)));
-            // TODO
-            // work out the type of grid and then get values
-            processTypedGrid((*pBegin));
+
+            VoxelChannel channel;
+            if (VoxelStore::FindChannel((*pBegin)->getName(), channel)) {
+                openvdb::GridBase::Ptr& channelGrid = channelGrids[static_cast<uint32_t>(channel)];
+                if (channelGrid) {
+                    std::cerr << "Duplicate " << (*pBegin)->getName() << " grid, keeping the first one" << std::endl;
+                } else {
+                    channelGrid = *pBegin;
+                }
+            }
         }
         ++pBegin;
         ++m_channel;
         setPointChannel(m_channel);
     }
 
-    return true;
+    return processTypedGrids(channelGrids);
 }
 
 bool VDB::loadVDBTree() {
@@ -940,83 +882,37 @@ void VDB::reportStringGridTypeError() {
     exit(EXIT_FAILURE);
 }
 
-template <typename GridType>
-void VDB::callGetValuesGridScalar(typename GridType::Ptr grid) {
-    // call the function to get high res data values with a scalar type
-    getMeshValuesScalar<GridType>(grid);
-}
-//
-template <typename GridType>
-void VDB::callGetValuesGridVector(typename GridType::Ptr grid) {
-    // call the function to get high res data values with a vector type
-    getMeshValuesVector<GridType>(grid);
-}
-//
 template <typename GridType>
 void VDB::callGetValuesTree(typename GridType::Ptr grid) {
     // call the function to get tree data values
     getTreeValues<GridType>(grid);
 }
 
-// inspiration taken from openvdb code examples in doxygen
-// http://www.openvdb.org/documentation/doxygen/codeExamples.html
-
-// TODO
-//// process the type of grid being passed to it using templates and then call
-/// the / correct function for scalar or vector to get high res data values
-void VDB::processTypedGrid(openvdb::GridBase::Ptr grid) {
-    // scalar types
-
-    std::cout << grid->isType<openvdb::FloatGrid>() << std::endl;
-
-    if (grid->isType<openvdb::BoolGrid>())
-        callGetValuesGridScalar<openvdb::BoolGrid>(
-            openvdb::gridPtrCast<openvdb::BoolGrid>(grid));
-    else if (grid->isType<openvdb::FloatGrid>())
-        callGetValuesGridScalar<openvdb::FloatGrid>(
-            openvdb::gridPtrCast<openvdb::FloatGrid>(grid));
-    else if (grid->isType<openvdb::DoubleGrid>())
-        callGetValuesGridScalar<openvdb::DoubleGrid>(
-            openvdb::gridPtrCast<openvdb::DoubleGrid>(grid));
-    else if (grid->isType<openvdb::Int32Grid>())
-        callGetValuesGridScalar<openvdb::Int32Grid>(
-            openvdb::gridPtrCast<openvdb::Int32Grid>(grid));
-    else if (grid->isType<openvdb::Int64Grid>())
-        callGetValuesGridScalar<openvdb::Int64Grid>(
-            openvdb::gridPtrCast<openvdb::Int64Grid>(grid));
-
-    else if (grid->isType<openvdb::MaskGrid>())
-        callGetValuesGridScalar<openvdb::MaskGrid>(
-            openvdb::gridPtrCast<openvdb::MaskGrid>(grid));
-
-    else if (grid->isType<openvdb::ScalarGrid>())
-        callGetValuesGridScalar<openvdb::ScalarGrid>(
-            openvdb::gridPtrCast<openvdb::ScalarGrid>(grid));
-
-    else if (grid->isType<openvdb::TopologyGrid>())
-        callGetValuesGridScalar<openvdb::TopologyGrid>(
-            openvdb::gridPtrCast<openvdb::TopologyGrid>(grid));
-
-    else if (grid->isType<openvdb::VectorGrid>())
-        callGetValuesGridVector<openvdb::VectorGrid>(
-            openvdb::gridPtrCast<openvdb::VectorGrid>(grid));
+// Converts the modeling grids at the same time, each grid's value type is resolved once by the
+// VoxelConverter visitor instead of a chain of isType checks
+bool VDB::processTypedGrids(const openvdb::GridPtrVec& _channelGrids) {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<VoxelConverter::GridConversion> conversions;
+    try {
+        conversions = VoxelConverter::ConvertGrids(_channelGrids, mVoxels);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
 
-    // vector types
-    else if (grid->isType<openvdb::Vec3IGrid>())
-        callGetValuesGridVector<openvdb::Vec3IGrid>(
-            openvdb::gridPtrCast<openvdb::Vec3IGrid>(grid));
-    else if (grid->isType<openvdb::Vec3SGrid>())
-        callGetValuesGridVector<openvdb::Vec3SGrid>(
-            openvdb::gridPtrCast<openvdb::Vec3SGrid>(grid));
-    else if (grid->isType<openvdb::Vec3DGrid>())
-        callGetValuesGridVector<openvdb::Vec3DGrid>(
-            openvdb::gridPtrCast<openvdb::Vec3DGrid>(grid));
-    else {
-        std::cerr << "File contain grid of type std::string - std::string is "
-            "currently not supported, closing application"
-            << std::endl;
-        /*exit(EXIT_FAILURE);*/
+    uint64_t voxelCount = 0;
+    for (size_t c = 0; c < _channelGrids.size(); ++c) {
+        if (!_channelGrids[c]) {
+            continue;
+        }
+        std::cout << "Converted " << conversions[c].voxelCount << " voxels of " << _channelGrids[c]->getName() << " in "
+            << conversions[c].milliseconds << " ms" << std::endl;
+        voxelCount += conversions[c].voxelCount;
     }
+    std::cout << "Converted " << voxelCount << " voxels in " << elapsed.count() * 1000.0 << " ms ("
+        << (elapsed.count() > 0.0 ? voxelCount / elapsed.count() / 1.0e6 : 0.0) << " Mvoxels/s)" << std::endl;
+    return true;
 }
 
 // TODO
@@ -24,6 +24,7 @@
 #include "glm/glm.hpp"
 
 #include "BoundBox.h"
+#include "VoxelStore.h"
 
 /// @file VDB.h
 /// @brief VDB class in this file handles the loading, drawing and attribute
@@ -33,6 +34,18 @@
 /// @date 12/02/2014
 /// Revision History:
 /// Initial Version 05/01/2014
+/// @struct VDBLoadOptions
+/// @brief Restricts what VDB::openFile reads from disk and what loadBasic builds
+struct VDBLoadOptions {
+    /// @brief Names of the grids to read, every grid in the file when empty
+    std::vector<std::string> gridNames;
+    /// @brief Only read voxels inside worldBounds, OpenVDB clips at node granularity
+    bool clip = false;
+    openvdb::BBoxd worldBounds;
+    /// @brief Tree statistics and the wireframe of the last grid, the renderer needs neither
+    bool loadTree = true;
+};
+
 /// @class VDB
 /// @brief VDB class handles the loading of a VDB file. Separates the attributes
 /// out and makes them accessible to other classes. Handles the templates used
@@ -45,7 +58,8 @@ public:
     VDB();
     /// @brief Constructor of the VDB class
     /// @param [in] _file std::string - file to load
-    VDB(std::string _file);
+    /// @param [in] _options VDBLoadOptions - grids and region to read
+    VDB(std::string _file, const VDBLoadOptions& _options = VDBLoadOptions());
     /// @brief Destructor of the VDB class
     ~VDB();
 
@@ -59,7 +73,8 @@ public:
 
     /// @brief Open and Load data from VDB file
     /// @param [in] _file std::string - file to load
-    void openFile(std::string _file);
+    /// @param [in] _options VDBLoadOptions - grids and region to read
+    void openFile(std::string _file, const VDBLoadOptions& _options = VDBLoadOptions());
     /// @brief Return if the file has been loaded or not - returns true or false
     inline bool loaded() { return m_loaded; }
     /// @brief Set transform of the VDB (global transform)
@@ -86,8 +101,6 @@ public:
     /// @param [in] _grid int - grid to query
     int getNumPointsAtGrid(int _grid);
 
-    const std::vector<openvdb::Vec4f>& getChannelDataForTexture();
-
     /// @brief Return the current active point render channel - returns int
     inline int pointChannel() { return m_currentActiveChannelPoints; }
     /// @brief Return the current active vector render channel - returns int
@@ -148,8 +161,8 @@ public:
     /// @brief Get the Bounding Box - returns BoundBox
     inline BoundBox getBBox() { return *m_bbox; }
 
-    std::vector<VDatAlt> mDataPoints;
-    glm::vec3 dimension;
+    /// @brief Dense copy of the modeling data grids, sized to their active bounding box by loadExt()
+    VoxelStore mVoxels;
 
     /// @brief Values to specify whether to draw certain tree levels
     int m_drawTreeLevels[4];
@@ -197,19 +210,6 @@ private:
     /// @brief Reset attributes and arrays
     void resetParams();
 
-    /// @brief Get mesh values out of the file on a scalar type
-    /// @param [in] _grid typename GridType::ConstPtr - the grid to retrieve
-    /// values from
-    template <typename GridType>
-    void getMeshValuesScalar(typename GridType::ConstPtr _grid);
-
-    // TODO
-    /// @brief Get mesh values out of the file on a vector type
-    /// @param [in] _grid typename GridType::ConstPtr - the grid to retrieve
-    /// values from
-    template <typename GridType>
-    void getMeshValuesVector(typename GridType::ConstPtr _grid);
-
     /// @brief Get tree values
     /// @param [in] _grid typename GridType::Ptr - the grid to retrieve values
     /// from
@@ -217,6 +217,8 @@ private:
     void getTreeValues(typename GridType::Ptr _grid);
     /// @brief The file name and path
     std::string m_fileName;
+    /// @brief Options the file was opened with
+    VDBLoadOptions m_options;
     /// @brief Specifies if the VDB grids have been initialised or not
     bool m_vdbGridsInitialized;
     /// @brief The transform of the VDB
@@ -310,17 +312,6 @@ private:
     GLint m_total_GPU_mem_kb;
     ///// @brief Current available GPU memory in KB
     // GLint m_current_available_GPU_mem_kb;
-    /// @brief Vector storing the channel value data to upload to a texture buffer
-    /// on the GPU
-    std::vector<openvdb::Vec4f>* m_channelValueData;
-    std::vector<openvdb::Vec4f> m_channelValueDataPub;
-
-    // Specifc vectors
-    std::vector<float> m_densityScaleData;
-    std::vector<float> m_detailTypeData;
-    std::vector<float> m_dimensionalProfileData;
-    std::vector<float> m_sdfData;
-
     // TODO
     ///// @brief Texture Buffer ID
     // GLuint m_gridsTBO;
@@ -334,12 +325,6 @@ private:
     // TODO
     /// @brief Report that the file contains a std::string grid
     void reportStringGridTypeError();
-    /// @brief Call appropriate scalar function to get values
-    template <typename GridType>
-    void callGetValuesGridScalar(typename GridType::Ptr grid);
-    /// @brief Call appropriate vector function to get values
-    template <typename GridType>
-    void callGetValuesGridVector(typename GridType::Ptr grid);
     /// @brief Call appropriate function to get VDB tree values
 
     // TODO
@@ -349,8 +334,9 @@ private:
     // TODO
     // inspiration taken from openvdb code examples in OpenVDBCookbook
     // http://www.openvdb.org/documentation/doxygen/codeExamples.html
-    /// @brief Process Grid type to call the correct get mesh function
-    void processTypedGrid(openvdb::GridBase::Ptr grid);
+    /// @brief Convert the modeling grids into mVoxels concurrently, one task per grid
+    /// @param [in] _channelGrids openvdb::GridPtrVec - the grid of each VoxelChannel, null if the file has none
+    bool processTypedGrids(const openvdb::GridPtrVec& _channelGrids);
 
     /// @brief Process Tree type to call the correct get tree values function
     void processTypedTree(openvdb::GridBase::Ptr grid);